@@ -0,0 +1,109 @@
+/**
+ * CPU Sleep/Active Duty-Cycle Accounting Implementation
+ */
+
+#include "cpuload.h"
+#include "crm.h"
+#include "systime.h"
+
+/* CYCCNT at the last wake (per-wake length) and at the last wake or
+ * sample, whichever came later (window accounting) */
+static uint32_t wake_cycles = 0;
+static uint32_t mark_cycles = 0;
+
+/* Current window */
+static uint64_t window_start_us = 0;
+static uint64_t window_active_cycles = 0;
+static uint32_t window_wakes = 0;
+static uint32_t window_max_cycles = 0;
+static uint32_t window_hist[CPULOAD_HIST_BUCKETS];
+
+/**
+ * @brief Core cycles per microsecond at the current HCLK
+ */
+static uint32_t cycles_per_us(void) {
+    return crm_get_clocks()->ahb_hz / 1000000U;
+}
+
+/**
+ * @brief Clear the window figures and start a new window at now_us
+ */
+static void window_reset(uint64_t now_us) {
+    window_start_us      = now_us;
+    window_active_cycles = 0;
+    window_wakes         = 0;
+    window_max_cycles    = 0;
+    for (uint32_t i = 0; i < CPULOAD_HIST_BUCKETS; i++) {
+        window_hist[i] = 0;
+    }
+}
+
+/**
+ * @brief Start accounting; the first window begins now
+ */
+void cpuload_init(void) {
+    wake_cycles = DWT->CYCCNT;
+    mark_cycles = wake_cycles;
+    window_reset(time_now_us());
+}
+
+/**
+ * @brief Call right before the main loop sleeps
+ */
+void cpuload_sleep_enter(void) {
+    uint32_t now = DWT->CYCCNT;
+    uint32_t cycles = now - wake_cycles;
+    uint32_t us = cycles / cycles_per_us();
+    uint32_t bucket;
+
+    window_active_cycles += now - mark_cycles;
+    window_wakes++;
+    if (cycles > window_max_cycles) {
+        window_max_cycles = cycles;
+    }
+
+    /* Power-of-4 buckets: bit length of us, two bits per bucket */
+    bucket = us ? (31U - __CLZ(us)) / 2U : 0U;
+    if (bucket >= CPULOAD_HIST_BUCKETS) {
+        bucket = CPULOAD_HIST_BUCKETS - 1U;
+    }
+    window_hist[bucket]++;
+}
+
+/**
+ * @brief Call right after the main loop wakes
+ */
+void cpuload_sleep_exit(void) {
+    wake_cycles = DWT->CYCCNT;
+    mark_cycles = wake_cycles;
+}
+
+/**
+ * @brief Report the window since the previous sample and start a new one
+ */
+void cpuload_sample(cpuload_stats_t* stats) {
+    uint64_t now_us = time_now_us();
+    uint32_t now = DWT->CYCCNT;
+    uint32_t mhz = cycles_per_us();
+
+    /* The wake in progress counts up to here; the rest goes to the next window */
+    window_active_cycles += now - mark_cycles;
+    mark_cycles = now;
+
+    stats->window_us     = (uint32_t)(now_us - window_start_us);
+    stats->active_us     = (uint32_t)(window_active_cycles / mhz);
+    if (stats->active_us > stats->window_us) {
+        stats->active_us = stats->window_us;    /* Clock changed mid-window */
+    }
+    stats->sleep_us      = stats->window_us - stats->active_us;
+    stats->load_permille = stats->window_us
+                         ? (uint32_t)(((uint64_t)stats->active_us * 1000U) / stats->window_us)
+                         : 0U;
+    stats->wakes         = window_wakes;
+    stats->max_active_us = window_max_cycles / mhz;
+    for (uint32_t i = 0; i < CPULOAD_HIST_BUCKETS; i++) {
+        stats->hist[i] = window_hist[i];
+    }
+
+    window_reset(now_us);
+}
@@ -0,0 +1,78 @@
+/**
+ * CPU Sleep/Active Duty-Cycle Accounting
+ *
+ * Purpose: Measure how much of the time the core is awake, for sizing the
+ *          power budget of deployed units
+ * Features: Active time per wake from the DWT cycle counter, window length
+ *           from the microsecond clock, CPU load in permille and a
+ *           histogram of active time per wake over each report window
+ * Performance: Two hooks per main loop iteration - a counter read, one
+ *              division and a CLZ on sleep entry, a counter read on wake
+ * Usage: Bracket the sleep of the main loop, then sample periodically
+ *
+ *   while (1) {
+ *       cpuload_sleep_enter();
+ *       dispatch_wait();
+ *       cpuload_sleep_exit();
+ *       ...
+ *   }
+ *
+ *   cpuload_stats_t load;
+ *   cpuload_sample(&load);      // window since the previous sample
+ *
+ * Measurement:
+ *   Active time is counted in core cycles from wake to the next sleep
+ *   entry, so it does not matter whether CYCCNT runs during __WFE() (on
+ *   many parts it stops). The window length comes from time_now_us(),
+ *   whose timer keeps counting in sleep; sleep time is the remainder.
+ *   Busy-waiting - e.g. in usart_flush() - is active time.
+ *
+ * Note: Interrupt handlers that run while the thread sleeps are counted
+ *       as sleep time; keep them short or measure them with prof.h.
+ */
+
+#ifndef CPULOAD_H
+#define CPULOAD_H
+
+#include "at32f421.h"
+
+/* Histogram buckets of active time per wake, in microseconds:
+ * <4, <16, <64, <256, <1024, <4096, <16384 and the rest */
+#define CPULOAD_HIST_BUCKETS        8U
+
+/**
+ * @brief Duty cycle over one report window
+ */
+typedef struct {
+    uint32_t window_us;             /*!< Length of the window */
+    uint32_t active_us;             /*!< Time awake in thread context */
+    uint32_t sleep_us;              /*!< window_us - active_us */
+    uint32_t load_permille;         /*!< active_us * 1000 / window_us */
+    uint32_t wakes;                 /*!< Completed sleep periods */
+    uint32_t max_active_us;         /*!< Longest single wake */
+    uint32_t hist[CPULOAD_HIST_BUCKETS]; /*!< Wakes per active-time bucket */
+} cpuload_stats_t;
+
+/**
+ * @brief Start accounting; the first window begins now
+ * @note The DWT cycle counter must be running (prof_init())
+ */
+void cpuload_init(void);
+
+/**
+ * @brief Call right before the main loop sleeps
+ */
+void cpuload_sleep_enter(void);
+
+/**
+ * @brief Call right after the main loop wakes
+ */
+void cpuload_sleep_exit(void);
+
+/**
+ * @brief Report the window since the previous sample and start a new one
+ * @param stats Receives the window's figures
+ */
+void cpuload_sample(cpuload_stats_t* stats);
+
+#endif /* CPULOAD_H */
@@ -3,9 +3,73 @@
  */
 
 #include "crm.h"
+#include "dispatch.h"
+
+/* crm_config() runs before USART1 is up, so only the run-time paths log */
+#define LOG_MODULE_NAME  "crm"
+#define LOG_MODULE_LEVEL LOG_LEVEL_CRM
+#include "log.h"
+
+static crm_clocks_t crm_clocks = {
+    CRM_RESET_CLOCK_HZ, CRM_RESET_CLOCK_HZ, CRM_RESET_CLOCK_HZ, CRM_RESET_CLOCK_HZ,
+    CRM_RESET_CLOCK_HZ, CRM_RESET_CLOCK_HZ
+};
+
+static crm_notify_t crm_notifiers[CRM_NOTIFY_MAX];
+static uint32_t crm_notifier_count = 0;
+
+/* Staged boot progress */
+typedef enum {
+    CRM_BOOT_DONE = 0,              /*!< No staged boot pending */
+    CRM_BOOT_HEXT,                  /*!< Waiting for HEXT */
+    CRM_BOOT_PLL                    /*!< Waiting for PLL lock */
+} crm_boot_stage_t;
+
+static crm_boot_stage_t crm_boot_stage = CRM_BOOT_DONE;
+
+/* Clock health; the PLL input changes to HICK after a HEXT failure */
+static crm_health_t crm_health_block;
+static uint32_t crm_pll_ref_hz = CRM_PLL_REF_HZ;
+static volatile uint32_t crm_failover_notify = 0;
+
+static crm_status_t crm_failover(void);
+
+/* Peripheral clock table, built from CRM_PERIPH_LIST */
+static const uint8_t crm_periph_bus[CRM_PERIPH_COUNT] = {
+#define CRM_PERIPH_BUS_(name, bus, bit)     bus,
+    CRM_PERIPH_LIST(CRM_PERIPH_BUS_)
+#undef CRM_PERIPH_BUS_
+};
+
+static const uint32_t crm_periph_bit[CRM_PERIPH_COUNT] = {
+#define CRM_PERIPH_BIT_(name, bus, bit)     bit,
+    CRM_PERIPH_LIST(CRM_PERIPH_BIT_)
+#undef CRM_PERIPH_BIT_
+};
+
+static const char* const crm_periph_names[CRM_PERIPH_COUNT] = {
+#define CRM_PERIPH_NAME_(name, bus, bit)    #name,
+    CRM_PERIPH_LIST(CRM_PERIPH_NAME_)
+#undef CRM_PERIPH_NAME_
+};
+
+static uint8_t crm_periph_ref[CRM_PERIPH_COUNT];
+
+/**
+ * @brief Publish a new system clock (APB dividers fixed by crm_config())
+ */
+static void crm_clocks_set(uint32_t hz) {
+    crm_clocks.sclk_hz = hz;
+    crm_clocks.ahb_hz  = hz;
+    crm_clocks.apb1_hz = hz / CRM_APB_DIV;
+    crm_clocks.apb2_hz = hz / CRM_APB_DIV;
+    crm_clocks.tmr_hz  = CRM_TMR_CLOCK(crm_clocks.apb1_hz);
+    crm_clocks.tmr2_hz = CRM_TMR_CLOCK(crm_clocks.apb2_hz);
+    SystemCoreClock    = hz;
+}
 
 /**
- * @brief Configure CRM system clock and enable all used peripheral clocks
+ * @brief Configure CRM system clock
  * 
  * @return CRM_OK if successful, or specific error code if failed
  */
@@ -13,11 +77,19 @@ crm_status_t crm_config(void) {
     uint32_t timeout;
 
 #ifdef HEXT_FREQUENCY
+    /* A crystal that failed is not tried again until reset */
+    if (crm_health_block.hext_failed) {
+        return crm_failover();
+    }
+
     /* Step 0: Enable and wait for HEXT (external crystal) to stabilize */
     CRM->ctrl |= CRM_CTRL_HEXTEN;
     timeout = CRM_HEXT_TIMEOUT;
     while (!(CRM->ctrl & CRM_CTRL_HEXTSTBL)) {
         if (--timeout == 0) {
+            /* Run degraded from HICK rather than at reset clocks */
+            crm_health_block.hext_timeouts++;
+            (void)crm_failover();
             return CRM_ERR_HEXT_TIMEOUT;
         }
     }
@@ -25,10 +97,8 @@ crm_status_t crm_config(void) {
 
     /* Step 1: Configure PLL multiplication factor and source in CFG register */
     CRM->cfg = CRM_CFG_PLLMULT_L |          /* PLL multiplication factor - low bits */
-#ifdef HEXT_FREQUENCY
-               CRM_CFG_PLLRCS_SEL |         /* PLL source selection (HEXT) */
-               CRM_CFG_PLLHEXTDIV_SEL |     /* HEXT divider */
-#endif
+               CRM_CFG_PLLRCS_SEL |         /* PLL source selection (solver) */
+               CRM_CFG_PLLHEXTDIV_SEL |     /* HEXT divider (solver) */
                CRM_CFG_PLLMULT_H;           /* PLL multiplication factor - high bits */
 
     /* Step 2: Enable PLL */
@@ -42,16 +112,20 @@ crm_status_t crm_config(void) {
         }
     }
 
+#if SYSTEM_CLOCK_HZ > CRM_AUTO_STEP_HZ
     /* Step 4: Enable auto-step mode for smooth clock switching (>108MHz) */
     CRM->misc2 |= CRM_MISC2_AUTO_STEP_EN;
+#endif
 
-    /* Step 5: Configure Flash for high-frequency operation with prefetch enabled */
-    FLASH->psr = FLASH_PSR_WTCYC_3 |        /* 3 wait cycles for high frequency */
+    /* Step 5: Configure Flash for the target frequency with prefetch enabled */
+    FLASH->psr = (CRM_FLASH_WTCYC << FLASH_PSR_WTCYC_Pos) | /* Wait cycles (solver) */
                  FLASH_PSR_PFT_EN |         /* Enable main prefetch buffer */
                  FLASH_PSR_PFT_EN2;         /* Enable prefetch buffer block 2 */
 
-    /* Step 6: Switch system clock to PLL (PLL config locked, dividers at defaults) */
-    CRM->cfg = CRM_CFG_SCLKSEL_PLL;
+    /* Step 6: Switch system clock to PLL (PLL config locked) with APB dividers */
+    CRM->cfg = CRM_CFG_SCLKSEL_PLL |
+               (CRM_CFG_APB_DIV_CODE << CRM_CFG_APB1DIV_Pos) |
+               (CRM_CFG_APB_DIV_CODE << CRM_CFG_APB2DIV_Pos);
 
     /* Step 7: Wait for system clock switch to complete */
     timeout = CRM_SWITCH_TIMEOUT;
@@ -61,13 +135,484 @@ crm_status_t crm_config(void) {
         }
     }
 
+#if SYSTEM_CLOCK_HZ > CRM_AUTO_STEP_HZ
     /* Step 8: Disable auto-step mode after successful switch */
     CRM->misc2 &= ~CRM_MISC2_AUTO_STEP_EN_Msk;
+#endif
 
-    /* Step 9: Enable all peripheral clocks used in this project */
-    CRM->ahben  = CRM_AHBEN_GPIOAEN;       /* Enable GPIOA clock */
-    CRM->apb1en = CRM_APB1EN_TMR14EN;      /* Enable TMR14 clock */
-    CRM->apb2en = CRM_APB2EN_USART1EN;     /* Enable USART1 clock */
+    crm_clocks_set(SYSTEM_CLOCK_HZ);
+
+#ifdef HEXT_FREQUENCY
+    /* Watch the crystal from now on (NMI_Handler() on failure) */
+    CRM->ctrl |= CRM_CTRL_CFDEN;
+#endif
 
     return CRM_OK;
 }
+
+/**
+ * @brief Enable register of a peripheral clock's bus
+ */
+static __IO uint32_t* crm_periph_reg(crm_periph_t periph) {
+    switch (crm_periph_bus[periph]) {
+    case CRM_BUS_AHB:
+        return &CRM->ahben;
+    case CRM_BUS_APB1:
+        return &CRM->apb1en;
+    default:
+        return &CRM->apb2en;
+    }
+}
+
+/**
+ * @brief Take a reference on a peripheral clock, enabling it on the first
+ */
+crm_status_t crm_periph_acquire(crm_periph_t periph) {
+    uint32_t primask;
+
+    if ((uint32_t)periph >= CRM_PERIPH_COUNT) {
+        return CRM_ERR_PERIPH;
+    }
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+    if (crm_periph_ref[periph] == CRM_PERIPH_REFS_MAX) {
+        __set_PRIMASK(primask);
+        return CRM_ERR_PERIPH;
+    }
+    if (crm_periph_ref[periph]++ == 0U) {
+        *crm_periph_reg(periph) |= crm_periph_bit[periph];
+    }
+    __set_PRIMASK(primask);
+    return CRM_OK;
+}
+
+/**
+ * @brief Drop a reference on a peripheral clock, gating it on the last
+ */
+crm_status_t crm_periph_release(crm_periph_t periph) {
+    uint32_t primask;
+
+    if ((uint32_t)periph >= CRM_PERIPH_COUNT) {
+        return CRM_ERR_PERIPH;
+    }
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+    if (crm_periph_ref[periph] == 0U) {
+        __set_PRIMASK(primask);
+        return CRM_ERR_PERIPH;
+    }
+    if (--crm_periph_ref[periph] == 0U) {
+        *crm_periph_reg(periph) &= ~crm_periph_bit[periph];
+    }
+    __set_PRIMASK(primask);
+    return CRM_OK;
+}
+
+/**
+ * @brief Current reference count of a peripheral clock (0 = gated)
+ */
+uint32_t crm_periph_refs(crm_periph_t periph) {
+    return ((uint32_t)periph < CRM_PERIPH_COUNT) ? crm_periph_ref[periph] : 0U;
+}
+
+/**
+ * @brief Whether the enable bit of a peripheral clock is set right now
+ */
+uint32_t crm_periph_enabled(crm_periph_t periph) {
+    if ((uint32_t)periph >= CRM_PERIPH_COUNT) {
+        return 0;
+    }
+    return (*crm_periph_reg(periph) & crm_periph_bit[periph]) != 0U;
+}
+
+/**
+ * @brief Name of a peripheral clock for reports ("DMA1", ...)
+ */
+const char* crm_periph_name(crm_periph_t periph) {
+    return ((uint32_t)periph < CRM_PERIPH_COUNT) ? crm_periph_names[periph] : "?";
+}
+
+/**
+ * @brief Bus frequencies currently in effect
+ */
+const crm_clocks_t* crm_get_clocks(void) {
+    return &crm_clocks;
+}
+
+/**
+ * @brief Flash wait cycles needed at a system clock frequency
+ */
+static uint32_t crm_flash_wtcyc(uint32_t hz) {
+    return ((hz - 1U) / CRM_FLASH_WS_STEP_HZ) << FLASH_PSR_WTCYC_Pos;
+}
+
+/**
+ * @brief PLLMULT field value for a multiplier (same coding as the solver)
+ */
+static uint32_t crm_pll_mult_field(uint32_t mult) {
+    uint32_t code = CRM_PLL_MULT_CODE(mult);
+
+    return ((code & 0xFU) << CRM_CFG_PLLMULT_L_Pos) | ((code >> 4) << CRM_CFG_PLLMULT_H_Pos);
+}
+
+/**
+ * @brief Select a system clock source and wait until it is in use
+ */
+static crm_status_t crm_sclk_switch(uint32_t sel, uint32_t sts) {
+    uint32_t timeout = CRM_SWITCH_TIMEOUT;
+
+    CRM->cfg = (CRM->cfg & ~CRM_CFG_SCLKSEL_Msk) | sel;
+    while ((CRM->cfg & CRM_CFG_SCLKSTS_Msk) != sts) {
+        if (--timeout == 0) {
+            return CRM_ERR_SWITCH_TIMEOUT;
+        }
+    }
+    return CRM_OK;
+}
+
+/**
+ * @brief Call every registered notifier
+ */
+static void crm_notify(crm_clock_event_t event) {
+    for (uint32_t i = 0; i < crm_notifier_count; i++) {
+        crm_notifiers[i](event);
+    }
+}
+
+/**
+ * @brief Change the system clock at run time
+ */
+crm_status_t crm_set_sysclk(uint32_t hz) {
+    uint32_t old_hz = crm_clocks.sclk_hz;
+    uint32_t now_hz = old_hz;
+    uint32_t mult = 0;
+    uint32_t step;
+    uint32_t timeout;
+    crm_status_t status;
+
+    if (crm_boot_stage != CRM_BOOT_DONE) {
+        return CRM_BUSY;
+    }
+    if ((hz % 1000000U) != 0U) {
+        return CRM_ERR_FREQUENCY;
+    }
+    if (hz != CRM_HICK_HZ) {
+        mult = hz / crm_pll_ref_hz;
+        if (((hz % crm_pll_ref_hz) != 0U) || (mult < CRM_PLL_MULT_MIN) ||
+            (mult > CRM_PLL_MULT_MAX) || (hz > CRM_SYSCLK_MAX_HZ)) {
+            return CRM_ERR_FREQUENCY;
+        }
+    }
+    if (hz == old_hz) {
+        return CRM_OK;
+    }
+
+    crm_notify(CRM_CLOCK_PRE_CHANGE);
+
+    /* Flash must be slow enough before the core gets faster */
+    if (hz > old_hz) {
+        FLASH->psr = (FLASH->psr & ~FLASH_PSR_WTCYC_Msk) | crm_flash_wtcyc(hz);
+    }
+    step = (hz > CRM_AUTO_STEP_HZ) || (old_hz > CRM_AUTO_STEP_HZ);
+    if (step) {
+        CRM->misc2 |= CRM_MISC2_AUTO_STEP_EN;
+    }
+
+    /* The PLL can only be reprogrammed while nothing runs from it */
+    status = crm_sclk_switch(CRM_CFG_SCLKSEL_HICK, CRM_CFG_SCLKSTS_HICK);
+    if (status == CRM_OK) {
+        now_hz = CRM_HICK_HZ;
+        CRM->ctrl &= ~CRM_CTRL_PLLEN;
+
+        if (mult != 0U) {
+            CRM->cfg = (CRM->cfg & ~(CRM_CFG_PLLMULT_L_Msk | CRM_CFG_PLLMULT_H_Msk)) |
+                       crm_pll_mult_field(mult);
+            CRM->ctrl |= CRM_CTRL_PLLEN;
+
+            timeout = CRM_PLL_TIMEOUT;
+            while (!(CRM->ctrl & CRM_CTRL_PLLSTBL)) {
+                if (--timeout == 0) {
+                    status = CRM_ERR_PLL_TIMEOUT;
+                    break;
+                }
+            }
+            if (status == CRM_OK) {
+                status = crm_sclk_switch(CRM_CFG_SCLKSEL_PLL, CRM_CFG_SCLKSTS_PLL);
+            }
+            if (status == CRM_OK) {
+                now_hz = hz;
+            }
+        }
+    }
+
+    if (step) {
+        CRM->misc2 &= ~CRM_MISC2_AUTO_STEP_EN_Msk;
+    }
+
+    /* Whatever clock the core ended up on gets matching flash timing */
+    FLASH->psr = (FLASH->psr & ~FLASH_PSR_WTCYC_Msk) | crm_flash_wtcyc(now_hz);
+    crm_clocks_set(now_hz);
+
+    crm_notify(CRM_CLOCK_POST_CHANGE);
+    if (status != CRM_OK) {
+        LOG_WARN("SYSCLK %uMHz failed (%u), now %uMHz", hz / 1000000U, (uint32_t)status,
+                 now_hz / 1000000U);
+    }
+    return status;
+}
+
+/**
+ * @brief Register a clock change notifier
+ */
+crm_status_t crm_notify_register(crm_notify_t notify) {
+    if (crm_notifier_count >= CRM_NOTIFY_MAX) {
+        return CRM_ERR_NOTIFY_FULL;
+    }
+    crm_notifiers[crm_notifier_count++] = notify;
+
+    /* The driver was set up for SYSTEM_CLOCK_HZ - bring it up to date */
+    if (crm_clocks.sclk_hz != SYSTEM_CLOCK_HZ) {
+        notify(CRM_CLOCK_POST_CHANGE);
+    }
+    return CRM_OK;
+}
+
+/**
+ * @brief Start a staged boot: dividers and PLL set up, HEXT/PLL started
+ */
+void crm_boot_start(void) {
+    /* HICK needs no wait cycles; crm_boot_poll() raises them before the switch */
+    FLASH->psr = FLASH_PSR_PFT_EN | FLASH_PSR_PFT_EN2;
+
+    /* PLL configuration and dividers now, while the PLL is off */
+    CRM->cfg = CRM_CFG_PLLMULT_L | CRM_CFG_PLLRCS_SEL | CRM_CFG_PLLHEXTDIV_SEL |
+               CRM_CFG_PLLMULT_H |
+               (CRM_CFG_APB_DIV_CODE << CRM_CFG_APB1DIV_Pos) |
+               (CRM_CFG_APB_DIV_CODE << CRM_CFG_APB2DIV_Pos);
+    crm_clocks_set(CRM_HICK_HZ);
+
+    /* Stable flags pend the CRM line; the NVIC line itself stays disabled */
+    CRM->clkint = CRM_CLKINT_HEXTSTBLFC | CRM_CLKINT_PLLSTBLFC;
+#ifdef HEXT_FREQUENCY
+    crm_boot_stage = CRM_BOOT_HEXT;
+    CRM->clkint = CRM_CLKINT_HEXTSTBLIEN | CRM_CLKINT_PLLSTBLIEN;
+    CRM->ctrl |= CRM_CTRL_HEXTEN;
+#else
+    crm_boot_stage = CRM_BOOT_PLL;
+    CRM->clkint = CRM_CLKINT_PLLSTBLIEN;
+    CRM->ctrl |= CRM_CTRL_PLLEN;
+#endif
+}
+
+/**
+ * @brief Dispatch check for the CRM interrupt line
+ */
+uint32_t crm_event_check(void) {
+    uint32_t clkint = CRM->clkint;
+    uint32_t ien = 0;
+
+    /* The stable interrupts are only wanted while a staged boot waits */
+    if (crm_boot_stage != CRM_BOOT_DONE) {
+        ien = clkint & (CRM_CLKINT_HEXTSTBLIEN | CRM_CLKINT_PLLSTBLIEN);
+    }
+    CRM->clkint = ien | CRM_CLKINT_HEXTSTBLFC | CRM_CLKINT_PLLSTBLFC;
+    return (clkint & (CRM_CLKINT_HEXTSTBLF | CRM_CLKINT_PLLSTBLF)) | crm_failover_notify;
+}
+
+/**
+ * @brief Advance a staged boot; switch to the PLL once it is locked
+ */
+crm_status_t crm_boot_poll(void) {
+    crm_status_t status;
+
+    if (crm_boot_stage == CRM_BOOT_HEXT) {
+        if (!(CRM->ctrl & CRM_CTRL_HEXTSTBL)) {
+            return CRM_BUSY;
+        }
+        crm_boot_stage = CRM_BOOT_PLL;
+        CRM->ctrl |= CRM_CTRL_PLLEN;
+    }
+    if (crm_boot_stage != CRM_BOOT_PLL) {
+        return CRM_OK;
+    }
+    if (!(CRM->ctrl & CRM_CTRL_PLLSTBL)) {
+        return CRM_BUSY;
+    }
+
+    crm_boot_stage = CRM_BOOT_DONE;
+    CRM->clkint = CRM_CLKINT_HEXTSTBLFC | CRM_CLKINT_PLLSTBLFC;
+
+    crm_notify(CRM_CLOCK_PRE_CHANGE);
+
+    FLASH->psr = (FLASH->psr & ~FLASH_PSR_WTCYC_Msk) | crm_flash_wtcyc(SYSTEM_CLOCK_HZ);
+#if SYSTEM_CLOCK_HZ > CRM_AUTO_STEP_HZ
+    CRM->misc2 |= CRM_MISC2_AUTO_STEP_EN;
+#endif
+    status = crm_sclk_switch(CRM_CFG_SCLKSEL_PLL, CRM_CFG_SCLKSTS_PLL);
+#if SYSTEM_CLOCK_HZ > CRM_AUTO_STEP_HZ
+    CRM->misc2 &= ~CRM_MISC2_AUTO_STEP_EN_Msk;
+#endif
+    if (status == CRM_OK) {
+        crm_clocks_set(SYSTEM_CLOCK_HZ);
+#ifdef HEXT_FREQUENCY
+        CRM->ctrl |= CRM_CTRL_CFDEN;
+#endif
+    }
+
+    crm_notify(CRM_CLOCK_POST_CHANGE);
+    if (status != CRM_OK) {
+        LOG_ERROR("PLL switch failed (%u), staying on HICK", (uint32_t)status);
+    } else {
+        LOG_INFO("SYSCLK: %uMHz", SYSTEM_CLOCK_HZ / 1000000U);
+    }
+    return status;
+}
+
+/**
+ * @brief Abandon a staged boot that did not finish in time
+ */
+crm_status_t crm_boot_cancel(void) {
+    crm_boot_stage_t stage = crm_boot_stage;
+
+    if (stage == CRM_BOOT_DONE) {
+        return CRM_OK;
+    }
+    crm_boot_stage = CRM_BOOT_DONE;
+    CRM->clkint = CRM_CLKINT_HEXTSTBLFC | CRM_CLKINT_PLLSTBLFC;
+
+    if (stage == CRM_BOOT_HEXT) {
+        crm_health_block.hext_timeouts++;
+        crm_notify(CRM_CLOCK_PRE_CHANGE);
+        (void)crm_failover();
+        crm_notify(CRM_CLOCK_POST_CHANGE);
+        LOG_ERROR("HEXT start timed out, SYSCLK %uMHz", crm_clocks.sclk_hz / 1000000U);
+        return CRM_ERR_HEXT_TIMEOUT;
+    }
+    CRM->ctrl &= ~(CRM_CTRL_PLLEN | CRM_CTRL_HEXTEN);
+    LOG_ERROR("PLL lock timed out, SYSCLK %uMHz", crm_clocks.sclk_hz / 1000000U);
+    return CRM_ERR_PLL_TIMEOUT;
+}
+
+/**
+ * @brief Whether a staged boot is still waiting for HEXT or the PLL
+ */
+uint32_t crm_boot_pending(void) {
+    return crm_boot_stage != CRM_BOOT_DONE;
+}
+
+/**
+ * @brief Run the PLL from HICK at CRM_FALLBACK_HZ once HEXT is unusable
+ *
+ * Leaves the notifiers to the caller. Runs inside the NMI, so the lock
+ * wait is short; if the PLL does not lock, it is switched off again, the
+ * core stays on HICK and crm_get_clocks() says so.
+ */
+static crm_status_t crm_failover(void) {
+    uint32_t timeout;
+    crm_status_t status;
+
+    crm_health_block.hext_failed = 1;
+    crm_pll_ref_hz = CRM_HICK_PLL_REF_HZ;
+
+    /* After a detected failure the hardware is on HICK already */
+    status = crm_sclk_switch(CRM_CFG_SCLKSEL_HICK, CRM_CFG_SCLKSTS_HICK);
+    CRM->ctrl &= ~(CRM_CTRL_PLLEN | CRM_CTRL_CFDEN | CRM_CTRL_HEXTEN);
+    crm_clocks_set(CRM_HICK_HZ);
+    if (status != CRM_OK) {
+        crm_health_block.failover_errors++;
+        return status;
+    }
+
+    /* APB dividers as crm_clocks_set() publishes them: when HEXT does not
+     * start, crm_config() gets here before its own CFG writes, with the
+     * dividers still at their reset value of 1 */
+    CRM->cfg = (CRM->cfg & ~(CRM_CFG_PLLMULT_L_Msk | CRM_CFG_PLLMULT_H_Msk |
+                             CRM_CFG_PLLRCS_Msk | CRM_CFG_PLLHEXTDIV_Msk |
+                             CRM_CFG_APB1DIV_Msk | CRM_CFG_APB2DIV_Msk)) |
+               CRM_CFG_PLLRCS_HICK | crm_pll_mult_field(CRM_FALLBACK_MULT) |
+               (CRM_CFG_APB_DIV_CODE << CRM_CFG_APB1DIV_Pos) |
+               (CRM_CFG_APB_DIV_CODE << CRM_CFG_APB2DIV_Pos);
+
+    CRM->clkint = CRM_CLKINT_PLLSTBLFC;
+    CRM->ctrl |= CRM_CTRL_PLLEN;
+
+    timeout = CRM_FAILOVER_PLL_TIMEOUT;
+    while (!(CRM->ctrl & CRM_CTRL_PLLSTBL)) {
+        if (--timeout == 0) {
+            CRM->ctrl &= ~CRM_CTRL_PLLEN;
+            FLASH->psr = (FLASH->psr & ~FLASH_PSR_WTCYC_Msk) | crm_flash_wtcyc(CRM_HICK_HZ);
+            crm_health_block.failover_errors++;
+            return CRM_ERR_PLL_TIMEOUT;
+        }
+    }
+
+    FLASH->psr = (FLASH->psr & ~FLASH_PSR_WTCYC_Msk) | crm_flash_wtcyc(CRM_FALLBACK_HZ);
+#if CRM_FALLBACK_HZ > CRM_AUTO_STEP_HZ
+    CRM->misc2 |= CRM_MISC2_AUTO_STEP_EN;
+#endif
+    status = crm_sclk_switch(CRM_CFG_SCLKSEL_PLL, CRM_CFG_SCLKSTS_PLL);
+#if CRM_FALLBACK_HZ > CRM_AUTO_STEP_HZ
+    CRM->misc2 &= ~CRM_MISC2_AUTO_STEP_EN_Msk;
+#endif
+    if (status != CRM_OK) {
+        crm_health_block.failover_errors++;
+        return status;
+    }
+    crm_clocks_set(CRM_FALLBACK_HZ);
+    return CRM_OK;
+}
+
+/**
+ * @brief Clock failure detector: HEXT stopped, the core already runs on HICK
+ */
+void NMI_Handler(void) {
+    if (!(CRM->clkint & CRM_CLKINT_CFDF)) {
+        crm_health_block.other_nmis++;
+        return;
+    }
+    CRM->clkint = CRM_CLKINT_CFDFC;
+    crm_health_block.clock_failures++;
+
+    (void)crm_failover();
+
+    /* Notifiers run in thread context - see crm_failover_poll(). A plain
+     * NVIC pend could be cleared by dispatch_wait() before it is seen. */
+    crm_failover_notify = 1;
+    dispatch_pend(CRM_IRQn);
+}
+
+/**
+ * @brief Finish a clock failover in thread context
+ */
+uint32_t crm_failover_poll(void) {
+    if (!crm_failover_notify) {
+        return 0;
+    }
+    crm_failover_notify = 0;
+    crm_notify(CRM_CLOCK_POST_CHANGE);
+    LOG_ERROR("HEXT failed, running on HICK at %uMHz (failures: %u)",
+              crm_clocks.sclk_hz / 1000000U, crm_health_block.clock_failures);
+    return 1;
+}
+
+/**
+ * @brief Publish the clocks the core really runs on after a failed restore
+ */
+void crm_clocks_sync(void) {
+    if ((CRM->cfg & CRM_CFG_SCLKSTS_Msk) != CRM_CFG_SCLKSTS_PLL) {
+        CRM->ctrl &= ~CRM_CTRL_PLLEN;
+        FLASH->psr = (FLASH->psr & ~FLASH_PSR_WTCYC_Msk) | crm_flash_wtcyc(CRM_HICK_HZ);
+        crm_clocks_set(CRM_HICK_HZ);
+    }
+    crm_notify(CRM_CLOCK_POST_CHANGE);
+    LOG_WARN("Clock restore failed, SYSCLK %uMHz", crm_clocks.sclk_hz / 1000000U);
+}
+
+/**
+ * @brief Clock health counters since reset
+ */
+const crm_health_t* crm_health(void) {
+    return &crm_health_block;
+}
@@ -4,28 +4,43 @@
  * Purpose: Configure AT32F421 CRM module for system clock and peripheral clocks
  * Features: Supports both internal HICK and external HEXT crystal sources
  * Performance: Optimized with Flash prefetch buffers and auto-step mode
- * Usage: Define HEXT_FREQUENCY (4,8,12,16,20,25) for external crystal or leave
- *        undefined to use internal 4MHz HICK oscillator
+ * Usage: Define HEXT_FREQUENCY (4 to 25, MHz) for an external crystal or
+ *        leave it undefined to use the internal HICK oscillator (4MHz at
+ *        the PLL); optionally define SYSTEM_CLOCK_HZ (default 120MHz)
  * 
  * Configuration Options:
  *   • HICK (default): 4MHz × 30 = 120MHz
- *   • HEXT 4MHz:      4MHz × 30 = 120MHz
- *   • HEXT 8MHz:      8MHz × 15 = 120MHz
- *   • HEXT 12MHz:     12MHz × 10 = 120MHz
- *   • HEXT 16MHz:     16MHz/2 × 15 = 120MHz
- *   • HEXT 20MHz:     20MHz/2 × 12 = 120MHz
- *   • HEXT 25MHz:     25MHz/2 × 10 = 125MHz (Warning: Not exactly 120MHz)
+ *   • HEXT_FREQUENCY: crystal in MHz; the PLL solver picks HEXT or HEXT/2
+ *     (inputs above 16MHz are always halved) and the multiplier
+ *   • SYSTEM_CLOCK_HZ: any multiple of the PLL input between x2 and x64, up
+ *     to 120MHz - e.g. 8MHz × 14 = 112MHz; #error if not reachable
+ *   • Default for a 25MHz crystal: 12.5MHz × 8 = 100MHz
+ *   • CRM_APB_MAX_HZ: bus limit from which the APB dividers are derived
+ *
+ * Derived at compile time: PLL source, HEXT divider, PLLMULT coding, flash
+ * wait cycles (CRM_FLASH_WTCYC), APB dividers and all *_CLOCK_HZ values.
  * 
  * Key Features:
  *   ✓ System clock configuration (up to 120MHz)
- *   ✓ Single function to enable all used peripheral clocks
- *   ✓ Automatic PLL multiplication calculation
+ *   ✓ Reference-counted peripheral clock gating (crm_periph_acquire/release)
+ *   ✓ Compile-time PLL solver for any crystal and target frequency
  *   ✓ Flash wait cycles optimized for high frequency
  *   ✓ Dual prefetch buffers enabled for maximum performance
  *   ✓ Auto-step mode for smooth clock transitions
  *   ✓ Robust timeout handling with error reporting
  *   ✓ Compile-time configuration validation
  *   ✓ Centralized system clock definitions for all modules
+ *   ✓ Run-time frequency scaling (crm_set_sysclk) with change notifiers
+ *   ✓ Staged boot: drivers start on HICK while HEXT and the PLL come up
+ *   ✓ HEXT failure detection with HICK x PLL fallback and health counters
+ *
+ * Peripheral Clocks:
+ *   Drivers switch on the bus clocks they use with crm_periph_acquire()
+ *   in their init function and hand them back with crm_periph_release()
+ *   when idle (e.g. TMR1 after autobaud). Each clock has a reference
+ *   count, so drivers sharing one (DMA1) do not switch it off under each
+ *   other, and the enable registers are only changed bit by bit. Add new
+ *   peripherals to CRM_PERIPH_LIST.
  * 
  * Example Usage:
  *   #define HEXT_FREQUENCY 8    // Use 8MHz external crystal
@@ -34,6 +49,34 @@
  *       // Handle clock configuration error
  *       while(1);  // Error: blink LED, reset, etc.
  *   }
+ *
+ * Staged Boot (CRM_STAGED_BOOT=1):
+ *   crm_config() polls for HEXT, PLL lock and the clock switch before any
+ *   driver runs. crm_boot_start() instead starts HEXT (or the PLL on HICK)
+ *   and returns at once; drivers come up on HICK, acquiring their own
+ *   clocks, and the first output leaves at 8MHz. The HEXT and PLL stable
+ *   flags raise the CRM interrupt line, which is registered as a dispatch
+ *   source; its handler calls crm_boot_poll(), which enables the PLL after
+ *   HEXT and switches to it once locked, running the clock notifiers like
+ *   crm_set_sysclk().
+ *
+ *   crm_boot_start();
+ *   ... drivers, first output ...
+ *   dispatch_register(p, CRM_IRQn, crm_event_check, on_clock);  // calls crm_boot_poll()
+ *
+ * Clock Failure (HEXT builds):
+ *   The clock failure detector is enabled once the core runs from the PLL.
+ *   If the crystal stops, the hardware moves the core to HICK and raises
+ *   the NMI; NMI_Handler() restarts the PLL from HICK at CRM_FALLBACK_HZ
+ *   (same as SYSTEM_CLOCK_HZ whenever that is a multiple of 4MHz) and
+ *   counts the event in crm_health(). The lock wait is bounded by
+ *   CRM_FAILOVER_PLL_TIMEOUT; a PLL that does not lock is switched off
+ *   again and the core stays on HICK. Either way the handler marks the
+ *   CRM line with dispatch_pend(), and crm_failover_poll() then runs the
+ *   POST_CHANGE notifiers in thread context so that dividers and baud
+ *   rates follow.
+ *   A crystal that does not start in crm_config() or a staged boot takes
+ *   the same fallback. HEXT is not tried again until reset.
  */
 
 #ifndef CRM_H
@@ -49,6 +92,17 @@
 #define CRM_PLL_TIMEOUT             50000U
 #define CRM_SWITCH_TIMEOUT          50000U
 
+/* Fallback PLL lock wait inside the NMI, which blocks every interrupt */
+#define CRM_FAILOVER_PLL_TIMEOUT    5000U
+
+/* Staged boot: start the PLL in the background (see crm_boot_start()) */
+#ifndef CRM_STAGED_BOOT
+  #define CRM_STAGED_BOOT           0
+#endif
+
+/* Time the application allows HEXT and the PLL to come up in a staged boot */
+#define CRM_BOOT_TIMEOUT_MS         50U
+
 /*******************************************************************************
  * CRM Status/Error Codes
  ******************************************************************************/
@@ -60,30 +114,180 @@ typedef enum {
     CRM_OK = 0,                     /*!< Operation completed successfully */
     CRM_ERR_HEXT_TIMEOUT,           /*!< External crystal failed to stabilize */
     CRM_ERR_PLL_TIMEOUT,            /*!< PLL failed to lock */
-    CRM_ERR_SWITCH_TIMEOUT          /*!< System clock switch failed */
+    CRM_ERR_SWITCH_TIMEOUT,         /*!< System clock switch failed */
+    CRM_ERR_FREQUENCY,              /*!< Requested frequency not reachable */
+    CRM_ERR_NOTIFY_FULL,            /*!< No free clock change notifier slot */
+    CRM_BUSY,                       /*!< Staged boot still waiting for HEXT or the PLL */
+    CRM_ERR_PERIPH                  /*!< Unknown peripheral or unbalanced release */
 } crm_status_t;
 
+/**
+ * @brief Clock health counters since reset
+ */
+typedef struct {
+    uint32_t clock_failures;        /*!< HEXT stopped while in use (NMI) */
+    uint32_t hext_timeouts;         /*!< HEXT did not start at boot */
+    uint32_t failover_errors;       /*!< HICK PLL did not lock - core left on HICK */
+    uint32_t other_nmis;            /*!< NMIs without a clock failure flag */
+    uint32_t hext_failed;           /*!< 1 = running from HICK until reset */
+} crm_health_t;
+
 /*******************************************************************************
  * System Clock Definitions - Single Source of Truth
  ******************************************************************************/
 
-/* System clock frequency - depends on crystal configuration */
-#if defined(HEXT_FREQUENCY) && (HEXT_FREQUENCY == 25)
-    #define SYSTEM_CLOCK_HZ         125000000U  /* 25MHz crystal case */
+/* After reset the core runs directly from HICK until crm_config() switches */
+#define CRM_RESET_CLOCK_HZ          8000000U
+#define CRM_HICK_HZ                 CRM_RESET_CLOCK_HZ
+
+/* Device limits */
+#ifndef CRM_SYSCLK_MAX_HZ
+  #define CRM_SYSCLK_MAX_HZ         120000000U
+#endif
+#ifndef CRM_APB_MAX_HZ
+  #define CRM_APB_MAX_HZ            120000000U  /* Lower it to slow both APB buses */
+#endif
+#define CRM_HEXT_MIN_HZ             4000000U
+#define CRM_HEXT_MAX_HZ             25000000U
+#define CRM_PLL_IN_MAX_HZ           16000000U   /* Faster crystals use the /2 divider */
+#define CRM_PLL_MULT_MIN            2U
+#define CRM_PLL_MULT_MAX            64U
+#define CRM_AUTO_STEP_HZ            108000000U  /* Switches above this use auto-step */
+#define CRM_FLASH_WS_STEP_HZ        32000000U   /* One flash wait cycle per 32MHz */
+
+/* Requested system clock; any whole number of Hz the PLL can produce */
+#ifndef SYSTEM_CLOCK_HZ
+  #if defined(HEXT_FREQUENCY) && (HEXT_FREQUENCY == 25)
+    #define SYSTEM_CLOCK_HZ         100000000U  /* 120MHz is not a multiple of 12.5MHz */
+  #else
+    #define SYSTEM_CLOCK_HZ         120000000U
+  #endif
+#endif
+
+#if SYSTEM_CLOCK_HZ > CRM_SYSCLK_MAX_HZ
+  #error "SYSTEM_CLOCK_HZ exceeds CRM_SYSCLK_MAX_HZ (120MHz)"
+#endif
+
+/*******************************************************************************
+ * PLL Solver - source, divider and multiplier for SYSTEM_CLOCK_HZ
+ ******************************************************************************/
+
+/* HICK reaches the PLL halved */
+#define CRM_HICK_PLL_REF_HZ         (CRM_HICK_HZ / 2U)
+
+#ifdef HEXT_FREQUENCY
+  #define CRM_HEXT_HZ               (HEXT_FREQUENCY * 1000000U)
+
+  #if (CRM_HEXT_HZ < CRM_HEXT_MIN_HZ) || (CRM_HEXT_HZ > CRM_HEXT_MAX_HZ)
+    #error "HEXT_FREQUENCY must be 4 to 25 (MHz)"
+  #endif
+
+  /* Undivided if the PLL accepts the crystal and the target is a multiple */
+  #if (CRM_HEXT_HZ <= CRM_PLL_IN_MAX_HZ) && ((SYSTEM_CLOCK_HZ % CRM_HEXT_HZ) == 0U)
+    #define CRM_PLL_REF_HZ          CRM_HEXT_HZ
+    #define CRM_CFG_PLLHEXTDIV_SEL  CRM_CFG_PLLHEXTDIV_1
+  #elif ((SYSTEM_CLOCK_HZ % (CRM_HEXT_HZ / 2U)) == 0U) && ((CRM_HEXT_HZ % 2U) == 0U)
+    #define CRM_PLL_REF_HZ          (CRM_HEXT_HZ / 2U)
+    #define CRM_CFG_PLLHEXTDIV_SEL  CRM_CFG_PLLHEXTDIV_2
+  #else
+    #error "SYSTEM_CLOCK_HZ is not a multiple of HEXT or HEXT/2 - pick another frequency"
+  #endif
+  #define CRM_CFG_PLLRCS_SEL        CRM_CFG_PLLRCS_HEXT
 #else
-    #define SYSTEM_CLOCK_HZ         120000000U  /* All other cases: HICK, 4/8/12/16/20MHz crystals */
+  #define CRM_PLL_REF_HZ            CRM_HICK_PLL_REF_HZ
+  #define CRM_CFG_PLLHEXTDIV_SEL    CRM_CFG_PLLHEXTDIV_1
+  #define CRM_CFG_PLLRCS_SEL        CRM_CFG_PLLRCS_HICK
+
+  #if (SYSTEM_CLOCK_HZ % CRM_PLL_REF_HZ) != 0U
+    #error "With HICK, SYSTEM_CLOCK_HZ must be a multiple of 4MHz"
+  #endif
+#endif
+
+#define PLL_MULT_FACTOR             (SYSTEM_CLOCK_HZ / CRM_PLL_REF_HZ)
+
+#if (PLL_MULT_FACTOR < CRM_PLL_MULT_MIN) || (PLL_MULT_FACTOR > CRM_PLL_MULT_MAX)
+  #error "SYSTEM_CLOCK_HZ needs a PLL multiplier outside x2..x64"
 #endif
 
-/* Derived bus frequencies (all running at system clock speed) */
+/* HICK x PLL fallback after a HEXT failure: the nearest 4MHz multiple */
+#define CRM_FALLBACK_MULT           (SYSTEM_CLOCK_HZ / CRM_HICK_PLL_REF_HZ)
+#define CRM_FALLBACK_HZ             (CRM_FALLBACK_MULT * CRM_HICK_PLL_REF_HZ)
+
+#if CRM_FALLBACK_MULT < CRM_PLL_MULT_MIN
+  #error "SYSTEM_CLOCK_HZ must be at least 8MHz"
+#endif
+
+/* PLLMULT coding: x2..x16 as mult - 2, x17..x64 as mult - 1 (code 15 repeats x16) */
+#define CRM_PLL_MULT_CODE(mult)     (((mult) <= 16U) ? ((mult) - 2U) : ((mult) - 1U))
+#define CRM_CFG_PLLMULT_L           ((CRM_PLL_MULT_CODE(PLL_MULT_FACTOR) & 0xFU) << CRM_CFG_PLLMULT_L_Pos)
+#define CRM_CFG_PLLMULT_H           ((CRM_PLL_MULT_CODE(PLL_MULT_FACTOR) >> 4) << CRM_CFG_PLLMULT_H_Pos)
+
+/* Flash wait cycles: one per started 32MHz */
+#define CRM_FLASH_WTCYC             ((SYSTEM_CLOCK_HZ - 1U) / CRM_FLASH_WS_STEP_HZ)
+
+/* APB dividers: the smallest power of two that keeps both buses in range */
+#if SYSTEM_CLOCK_HZ <= CRM_APB_MAX_HZ
+  #define CRM_APB_DIV               1U
+  #define CRM_CFG_APB_DIV_CODE      0x0U
+#elif SYSTEM_CLOCK_HZ <= (2U * CRM_APB_MAX_HZ)
+  #define CRM_APB_DIV               2U
+  #define CRM_CFG_APB_DIV_CODE      0x4U
+#elif SYSTEM_CLOCK_HZ <= (4U * CRM_APB_MAX_HZ)
+  #define CRM_APB_DIV               4U
+  #define CRM_CFG_APB_DIV_CODE      0x5U
+#else
+  #define CRM_APB_DIV               8U
+  #define CRM_CFG_APB_DIV_CODE      0x6U
+#endif
+
+/*******************************************************************************
+ * Derived Bus Frequencies
+ ******************************************************************************/
+
 #define AHB_CLOCK_HZ                SYSTEM_CLOCK_HZ
-#define APB1_CLOCK_HZ               SYSTEM_CLOCK_HZ
-#define APB2_CLOCK_HZ               SYSTEM_CLOCK_HZ
+#define APB1_CLOCK_HZ               (SYSTEM_CLOCK_HZ / CRM_APB_DIV)
+#define APB2_CLOCK_HZ               (SYSTEM_CLOCK_HZ / CRM_APB_DIV)
+
+/* Timers run at twice PCLK when their APB bus is divided */
+#define CRM_TMR_CLOCK(apb_hz)       ((CRM_APB_DIV == 1U) ? (apb_hz) : (2U * (apb_hz)))
 
 /* Peripheral clock sources for modules to use */
-#define TIMER_CLOCK_HZ              APB1_CLOCK_HZ
+#define TIMER_CLOCK_HZ              CRM_TMR_CLOCK(APB1_CLOCK_HZ)
 #define USART1_CLOCK_HZ             APB2_CLOCK_HZ
 #define GPIO_CLOCK_HZ               AHB_CLOCK_HZ
 
+/* Room for clock change notifiers (one per driver with clock-derived timing) */
+#define CRM_NOTIFY_MAX              8U
+
+/**
+ * @brief Phase of a run-time clock change
+ */
+typedef enum {
+    CRM_CLOCK_PRE_CHANGE = 0,       /*!< About to switch: finish transfers */
+    CRM_CLOCK_POST_CHANGE           /*!< crm_get_clocks() has the new rates */
+} crm_clock_event_t;
+
+/**
+ * @brief Clock change notifier, called in the context of crm_set_sysclk()
+ */
+typedef void (*crm_notify_t)(crm_clock_event_t event);
+
+/**
+ * @brief Bus frequencies currently in effect
+ *
+ * The *_CLOCK_HZ macros above describe the configured target; this block
+ * follows the hardware, so code that must stay correct across clock
+ * changes (e.g. usart_set_baud()) reads it instead.
+ */
+typedef struct {
+    uint32_t sclk_hz;               /*!< System clock */
+    uint32_t ahb_hz;                /*!< AHB (HCLK) */
+    uint32_t apb1_hz;               /*!< APB1 (PCLK1) */
+    uint32_t apb2_hz;               /*!< APB2 (PCLK2) */
+    uint32_t tmr_hz;                /*!< Timer kernel clock on APB1 */
+    uint32_t tmr2_hz;               /*!< Timer kernel clock on APB2 (TMR1, TMR15-17) */
+} crm_clocks_t;
+
 /*******************************************************************************
  * CRM CFG Register Bit Definitions
  ******************************************************************************/
@@ -98,6 +302,7 @@ typedef enum {
 /* System Clock Status */
 #define CRM_CFG_SCLKSTS_Pos         2
 #define CRM_CFG_SCLKSTS_Msk         (0x3U << CRM_CFG_SCLKSTS_Pos)
+#define CRM_CFG_SCLKSTS_HICK        (0x0U << CRM_CFG_SCLKSTS_Pos)
 #define CRM_CFG_SCLKSTS_PLL         (0x2U << CRM_CFG_SCLKSTS_Pos)
 
 /* AHB Clock Divider */
@@ -137,11 +342,19 @@ typedef enum {
  * CRM CTRL Register Bit Definitions
  ******************************************************************************/
 
+/* HICK Trimming (factory calibration in HICKCAL, user offset in HICKTRIM) */
+#define CRM_CTRL_HICKTRIM_Pos       2
+#define CRM_CTRL_HICKTRIM_Msk       (0x3FU << CRM_CTRL_HICKTRIM_Pos)
+#define CRM_CTRL_HICKTRIM_DEFAULT   0x20U
+#define CRM_CTRL_HICKTRIM_MAX       0x3FU
+
 /* HEXT Control */
 #define CRM_CTRL_HEXTEN_Pos         16
 #define CRM_CTRL_HEXTEN             (0x1U << CRM_CTRL_HEXTEN_Pos)
 #define CRM_CTRL_HEXTSTBL_Pos       17
 #define CRM_CTRL_HEXTSTBL           (0x1U << CRM_CTRL_HEXTSTBL_Pos)
+#define CRM_CTRL_CFDEN_Pos          19      /* Clock failure detector */
+#define CRM_CTRL_CFDEN              (0x1U << CRM_CTRL_CFDEN_Pos)
 
 /* PLL Control */
 #define CRM_CTRL_PLLEN_Pos          24
@@ -149,6 +362,32 @@ typedef enum {
 #define CRM_CTRL_PLLSTBL_Pos        25
 #define CRM_CTRL_PLLSTBL            (0x1U << CRM_CTRL_PLLSTBL_Pos)
 
+/*******************************************************************************
+ * CRM CLKINT Register Bit Definitions
+ ******************************************************************************/
+
+/* Stable and clock failure flags (read-only) */
+#define CRM_CLKINT_HEXTSTBLF_Pos    3
+#define CRM_CLKINT_HEXTSTBLF        (0x1U << CRM_CLKINT_HEXTSTBLF_Pos)
+#define CRM_CLKINT_PLLSTBLF_Pos     4
+#define CRM_CLKINT_PLLSTBLF         (0x1U << CRM_CLKINT_PLLSTBLF_Pos)
+#define CRM_CLKINT_CFDF_Pos         7
+#define CRM_CLKINT_CFDF             (0x1U << CRM_CLKINT_CFDF_Pos)
+
+/* Stable interrupt enables */
+#define CRM_CLKINT_HEXTSTBLIEN_Pos  11
+#define CRM_CLKINT_HEXTSTBLIEN      (0x1U << CRM_CLKINT_HEXTSTBLIEN_Pos)
+#define CRM_CLKINT_PLLSTBLIEN_Pos   12
+#define CRM_CLKINT_PLLSTBLIEN       (0x1U << CRM_CLKINT_PLLSTBLIEN_Pos)
+
+/* Stable flag clears (write 1) */
+#define CRM_CLKINT_HEXTSTBLFC_Pos   19
+#define CRM_CLKINT_HEXTSTBLFC       (0x1U << CRM_CLKINT_HEXTSTBLFC_Pos)
+#define CRM_CLKINT_PLLSTBLFC_Pos    20
+#define CRM_CLKINT_PLLSTBLFC        (0x1U << CRM_CLKINT_PLLSTBLFC_Pos)
+#define CRM_CLKINT_CFDFC_Pos        23
+#define CRM_CLKINT_CFDFC            (0x1U << CRM_CLKINT_CFDFC_Pos)
+
 /*******************************************************************************
  * CRM MISC2 Register Bit Definitions
  ******************************************************************************/
@@ -163,17 +402,53 @@ typedef enum {
  ******************************************************************************/
 
 /* AHB Peripheral Clock Enable */
+#define CRM_AHBEN_DMA1EN_Pos        0
+#define CRM_AHBEN_DMA1EN            (0x1U << CRM_AHBEN_DMA1EN_Pos)
 #define CRM_AHBEN_GPIOAEN_Pos       17
 #define CRM_AHBEN_GPIOAEN           (0x1U << CRM_AHBEN_GPIOAEN_Pos)
 
 /* APB1 Peripheral Clock Enable */
+#define CRM_APB1EN_TMR3EN_Pos       1
+#define CRM_APB1EN_TMR3EN           (0x1U << CRM_APB1EN_TMR3EN_Pos)
+#define CRM_APB1EN_TMR6EN_Pos       4
+#define CRM_APB1EN_TMR6EN           (0x1U << CRM_APB1EN_TMR6EN_Pos)
 #define CRM_APB1EN_TMR14EN_Pos      8
 #define CRM_APB1EN_TMR14EN          (0x1U << CRM_APB1EN_TMR14EN_Pos)
+#define CRM_APB1EN_PWCEN_Pos        28
+#define CRM_APB1EN_PWCEN            (0x1U << CRM_APB1EN_PWCEN_Pos)
 
 /* APB2 Peripheral Clock Enable */
+#define CRM_APB2EN_TMR1EN_Pos       11
+#define CRM_APB2EN_TMR1EN           (0x1U << CRM_APB2EN_TMR1EN_Pos)
 #define CRM_APB2EN_USART1EN_Pos     14
 #define CRM_APB2EN_USART1EN         (0x1U << CRM_APB2EN_USART1EN_Pos)
 
+/*******************************************************************************
+ * CRM CTRLSTS / BPDC Register Bit Definitions (low-speed clocks, ERTC)
+ ******************************************************************************/
+
+/* LICK (internal low-speed clock) Control */
+#define CRM_CTRLSTS_LICKEN_Pos      0
+#define CRM_CTRLSTS_LICKEN          (0x1U << CRM_CTRLSTS_LICKEN_Pos)
+#define CRM_CTRLSTS_LICKSTBL_Pos    1
+#define CRM_CTRLSTS_LICKSTBL        (0x1U << CRM_CTRLSTS_LICKSTBL_Pos)
+
+/* LEXT (32.768kHz crystal) Control */
+#define CRM_BPDC_LEXTEN_Pos         0
+#define CRM_BPDC_LEXTEN             (0x1U << CRM_BPDC_LEXTEN_Pos)
+#define CRM_BPDC_LEXTSTBL_Pos       1
+#define CRM_BPDC_LEXTSTBL           (0x1U << CRM_BPDC_LEXTSTBL_Pos)
+
+/* ERTC Clock Selection and Enable */
+#define CRM_BPDC_ERTCSEL_Pos        8
+#define CRM_BPDC_ERTCSEL_Msk        (0x3U << CRM_BPDC_ERTCSEL_Pos)
+#define CRM_BPDC_ERTCSEL_LEXT       (0x1U << CRM_BPDC_ERTCSEL_Pos)
+#define CRM_BPDC_ERTCSEL_LICK       (0x2U << CRM_BPDC_ERTCSEL_Pos)
+#define CRM_BPDC_ERTCEN_Pos         15
+#define CRM_BPDC_ERTCEN             (0x1U << CRM_BPDC_ERTCEN_Pos)
+#define CRM_BPDC_BPDRST_Pos         16
+#define CRM_BPDC_BPDRST             (0x1U << CRM_BPDC_BPDRST_Pos)
+
 /*******************************************************************************
  * Flash PSR Register Bit Definitions
  ******************************************************************************/
@@ -190,85 +465,207 @@ typedef enum {
 #define FLASH_PSR_PFT_EN2           (0x1U << FLASH_PSR_PFT_EN2_Pos)    /* Prefetch buffer block 2 enable */
 
 /*******************************************************************************
- * PLL Configuration Based on Clock Source
+ * Peripheral Clock Gating
  ******************************************************************************/
 
-#ifdef HEXT_FREQUENCY
-  /* HEXT PLL configurations for different crystal frequencies targeting ~120MHz */
-  #if HEXT_FREQUENCY == 4
-    /* 4MHz HEXT -> 120MHz: 4MHz × 30 = 120MHz */
-    #define PLL_MULT_FACTOR         30
-    #define CRM_CFG_PLLRCS_SEL      CRM_CFG_PLLRCS_HEXT
-    #define CRM_CFG_PLLHEXTDIV_SEL  CRM_CFG_PLLHEXTDIV_1
-  #elif HEXT_FREQUENCY == 8
-    /* 8MHz HEXT -> 120MHz: 8MHz × 15 = 120MHz */
-    #define PLL_MULT_FACTOR         15
-    #define CRM_CFG_PLLRCS_SEL      CRM_CFG_PLLRCS_HEXT
-    #define CRM_CFG_PLLHEXTDIV_SEL  CRM_CFG_PLLHEXTDIV_1
-  #elif HEXT_FREQUENCY == 12
-    /* 12MHz HEXT -> 120MHz: 12MHz × 10 = 120MHz */
-    #define PLL_MULT_FACTOR         10
-    #define CRM_CFG_PLLRCS_SEL      CRM_CFG_PLLRCS_HEXT
-    #define CRM_CFG_PLLHEXTDIV_SEL  CRM_CFG_PLLHEXTDIV_1
-  #elif HEXT_FREQUENCY == 16
-    /* 16MHz HEXT/2 -> 120MHz: 8MHz × 15 = 120MHz */
-    #define PLL_MULT_FACTOR         15
-    #define CRM_CFG_PLLRCS_SEL      CRM_CFG_PLLRCS_HEXT
-    #define CRM_CFG_PLLHEXTDIV_SEL  CRM_CFG_PLLHEXTDIV_2
-  #elif HEXT_FREQUENCY == 20
-    /* 20MHz HEXT/2 -> 120MHz: 10MHz × 12 = 120MHz */
-    #define PLL_MULT_FACTOR         12
-    #define CRM_CFG_PLLRCS_SEL      CRM_CFG_PLLRCS_HEXT
-    #define CRM_CFG_PLLHEXTDIV_SEL  CRM_CFG_PLLHEXTDIV_2
-  #elif HEXT_FREQUENCY == 25
-    /* 25MHz HEXT/2 -> 125MHz: 12.5MHz × 10 = 125MHz */
-    #define PLL_MULT_FACTOR         10
-    #define CRM_CFG_PLLRCS_SEL      CRM_CFG_PLLRCS_HEXT
-    #define CRM_CFG_PLLHEXTDIV_SEL  CRM_CFG_PLLHEXTDIV_2
-    #warning "25MHz crystal results in 125MHz system clock (not exactly 120MHz)"
-  #else
-    #error "Unsupported HEXT frequency. Supported: 4, 8, 12, 16, 20, 25 MHz"
-  #endif
+/**
+ * @brief Bus enable register a peripheral clock lives in
+ */
+typedef enum {
+    CRM_BUS_AHB = 0,                /*!< CRM->ahben */
+    CRM_BUS_APB1,                   /*!< CRM->apb1en */
+    CRM_BUS_APB2                    /*!< CRM->apb2en */
+} crm_bus_t;
+
+/* Gated peripheral clocks: X(name, bus, enable bit) */
+#define CRM_PERIPH_LIST(X) \
+    X(DMA1,   CRM_BUS_AHB,  CRM_AHBEN_DMA1EN)   \
+    X(GPIOA,  CRM_BUS_AHB,  CRM_AHBEN_GPIOAEN)  \
+    X(TMR3,   CRM_BUS_APB1, CRM_APB1EN_TMR3EN)  \
+    X(TMR6,   CRM_BUS_APB1, CRM_APB1EN_TMR6EN)  \
+    X(TMR14,  CRM_BUS_APB1, CRM_APB1EN_TMR14EN) \
+    X(PWC,    CRM_BUS_APB1, CRM_APB1EN_PWCEN)   \
+    X(TMR1,   CRM_BUS_APB2, CRM_APB2EN_TMR1EN)  \
+    X(USART1, CRM_BUS_APB2, CRM_APB2EN_USART1EN)
 
-  /* Calculate PLL multiplication factor encoding for HEXT */
-  #define CRM_CFG_PLLMULT_L      (((PLL_MULT_FACTOR - 2) & 0x0F) << CRM_CFG_PLLMULT_L_Pos)
-  #define CRM_CFG_PLLMULT_H      (((PLL_MULT_FACTOR - 2) >> 4) << CRM_CFG_PLLMULT_H_Pos)
-#else
-  /* HICK PLL configuration: 4MHz × 30 = 120MHz */
-  #define PLL_MULT_FACTOR        30
-  #define CRM_CFG_PLLMULT_L      (0xEU << CRM_CFG_PLLMULT_L_Pos)  /* Low 4 bits: 1110 */
-  #define CRM_CFG_PLLMULT_H      (0x1U << CRM_CFG_PLLMULT_H_Pos)  /* High 2 bits: 01 */
-  /* Note: PLLRCS = 0 (HICK) and PLLHEXTDIV = 0 by default, no need to OR with 0 */
-#endif
+/**
+ * @brief Peripheral clock identifiers (CRM_PERIPH_DMA1, ...)
+ */
+typedef enum {
+#define CRM_PERIPH_ENUM_(name, bus, bit)    CRM_PERIPH_##name,
+    CRM_PERIPH_LIST(CRM_PERIPH_ENUM_)
+#undef CRM_PERIPH_ENUM_
+    CRM_PERIPH_COUNT
+} crm_periph_t;
+
+/* Highest reference count per peripheral */
+#define CRM_PERIPH_REFS_MAX         255U
 
 /*******************************************************************************
  * Function Declarations
  ******************************************************************************/
 
 /**
- * @brief Configure CRM system clock and enable all used peripheral clocks
+ * @brief Configure CRM system clock
  * 
  * System Clock Configuration:
- * - System clock target = SYSTEM_CLOCK_HZ (120MHz or 125MHz for 25MHz crystal)
+ * - System clock target = SYSTEM_CLOCK_HZ (default 120MHz, 100MHz for 25MHz crystal)
  * - System clock source = PLL
  * - AHB divider         = 1 (HCLK = SCLK)
- * - APB2 divider        = 1 (PCLK2 = SCLK)
- * - APB1 divider        = 1 (PCLK1 = SCLK)
- * - Auto-step mode      = enabled (recommended for >108MHz)
- * - Flash wait cycles   = 3
+ * - APB2 divider        = CRM_APB_DIV (1 unless CRM_APB_MAX_HZ is lowered)
+ * - APB1 divider        = CRM_APB_DIV
+ * - Auto-step mode      = enabled above 108MHz
+ * - Flash wait cycles   = CRM_FLASH_WTCYC (3 at 120MHz)
  * - Flash prefetch      = enabled (both buffers)
  * 
- * Enabled Peripheral Clocks:
- * - GPIOA  (for PA4, PA9, PA10)
- * - TMR14  (for PWM output)
- * - USART1 (for serial communication)
+ * Peripheral clocks are left alone - drivers acquire their own
+ * (crm_periph_acquire()).
  * 
+ * With HEXT_FREQUENCY, the clock failure detector is enabled at the end.
+ * A crystal that does not start leaves the core on the HICK x PLL
+ * fallback (CRM_FALLBACK_HZ) and is not tried again until reset.
+ *
  * @return CRM_OK if successful, or specific error code if failed
  * @retval CRM_OK                Configuration successful
- * @retval CRM_ERR_HEXT_TIMEOUT  External crystal failed to stabilize
+ * @retval CRM_ERR_HEXT_TIMEOUT  External crystal failed to stabilize - running
+ *                               on the fallback (or on HICK, see crm_health())
  * @retval CRM_ERR_PLL_TIMEOUT   PLL failed to lock
  * @retval CRM_ERR_SWITCH_TIMEOUT System clock switch failed
  */
 crm_status_t crm_config(void);
 
+/**
+ * @brief Change the system clock at run time
+ *
+ * CRM_HICK_HZ runs the core from HICK directly with the PLL off; any other
+ * frequency is a multiple of CRM_PLL_REF_HZ (CRM_HICK_PLL_REF_HZ after a
+ * HEXT failure) from the PLL. Flash wait cycles
+ * follow the frequency (raised before a speed-up, lowered after a
+ * slow-down), auto-step is used around switches above CRM_AUTO_STEP_HZ,
+ * and SystemCoreClock and crm_get_clocks() are updated. Registered
+ * notifiers run before and after the switch, even if it fails midway.
+ *
+ * @param hz New system clock; a whole number of MHz (timers count
+ *           microseconds), at most CRM_SYSCLK_MAX_HZ
+ * @return CRM_OK, CRM_ERR_FREQUENCY if hz is not reachable, CRM_BUSY while
+ *         a staged boot is pending, or a timeout code - then the core
+ *         keeps running on HICK (or the old clock)
+ */
+crm_status_t crm_set_sysclk(uint32_t hz);
+
+/**
+ * @brief Register a clock change notifier
+ *
+ * Drivers whose prescalers or divisors derive from a bus clock register
+ * one at init and reprogram themselves from crm_get_clocks() on
+ * CRM_CLOCK_POST_CHANGE. Drivers set up their compile-time values for
+ * SYSTEM_CLOCK_HZ; if the core runs at another frequency when they
+ * register (staged boot, failed crm_config()), the notifier is called
+ * with CRM_CLOCK_POST_CHANGE at once.
+ * @return CRM_OK or CRM_ERR_NOTIFY_FULL
+ */
+crm_status_t crm_notify_register(crm_notify_t notify);
+
+/**
+ * @brief Start a staged boot: dividers and PLL set up, HEXT/PLL started
+ *
+ * Replaces crm_config(). The core stays on HICK with the flash set up for
+ * it; the APB dividers and PLL configuration are written in advance. Does
+ * not wait for anything.
+ */
+void crm_boot_start(void);
+
+/**
+ * @brief Dispatch check for the CRM interrupt line
+ * @return Non-zero if a HEXT or PLL stable flag was set (flags cleared) or
+ *         a clock failover awaits crm_failover_poll()
+ */
+uint32_t crm_event_check(void);
+
+/**
+ * @brief Advance a staged boot; switch to the PLL once it is locked
+ * @return CRM_BUSY while waiting, CRM_OK once on SYSTEM_CLOCK_HZ (also if
+ *         no staged boot is pending), or CRM_ERR_SWITCH_TIMEOUT
+ */
+crm_status_t crm_boot_poll(void);
+
+/**
+ * @brief Abandon a staged boot that did not finish in time
+ *
+ * A crystal that did not start is replaced by the HICK x PLL fallback
+ * (notifiers run); a PLL that did not lock is switched off and the core
+ * keeps running on HICK.
+ * @return CRM_ERR_HEXT_TIMEOUT or CRM_ERR_PLL_TIMEOUT for the stage that
+ *         was pending, CRM_OK if none was
+ */
+crm_status_t crm_boot_cancel(void);
+
+/**
+ * @brief Whether a staged boot is still waiting for HEXT or the PLL
+ */
+uint32_t crm_boot_pending(void);
+
+/**
+ * @brief Take a reference on a peripheral clock, enabling it on the first
+ * @return CRM_OK, or CRM_ERR_PERIPH for an unknown peripheral or a count
+ *         already at CRM_PERIPH_REFS_MAX
+ */
+crm_status_t crm_periph_acquire(crm_periph_t periph);
+
+/**
+ * @brief Drop a reference on a peripheral clock, gating it on the last
+ * @note The peripheral's registers keep their values while gated but
+ *       cannot be accessed
+ * @return CRM_OK, or CRM_ERR_PERIPH for an unknown peripheral or a
+ *         release without acquire
+ */
+crm_status_t crm_periph_release(crm_periph_t periph);
+
+/**
+ * @brief Current reference count of a peripheral clock (0 = gated)
+ */
+uint32_t crm_periph_refs(crm_periph_t periph);
+
+/**
+ * @brief Whether the enable bit of a peripheral clock is set right now
+ *
+ * Differs from crm_periph_refs() != 0 only if code writes the enable
+ * registers directly.
+ */
+uint32_t crm_periph_enabled(crm_periph_t periph);
+
+/**
+ * @brief Name of a peripheral clock for reports ("DMA1", ...)
+ */
+const char* crm_periph_name(crm_periph_t periph);
+
+/**
+ * @brief Finish a clock failover in thread context
+ *
+ * Runs the CRM_CLOCK_POST_CHANGE notifiers after NMI_Handler() moved the
+ * core to the HICK x PLL fallback. Call from the CRM dispatch handler.
+ * @return Non-zero if a failover happened since the last call
+ */
+uint32_t crm_failover_poll(void);
+
+/**
+ * @brief Publish the clocks the core really runs on after a failed restore
+ *
+ * If the core is not on the PLL, the PLL is switched off and the HICK
+ * clocks are published; otherwise the published PLL clocks stand. Either
+ * way the CRM_CLOCK_POST_CHANGE notifiers run, so drivers match again.
+ */
+void crm_clocks_sync(void);
+
+/**
+ * @brief Clock health counters since reset
+ */
+const crm_health_t* crm_health(void);
+
+/**
+ * @brief Bus frequencies currently in effect
+ * @return Reset values (CRM_RESET_CLOCK_HZ) until crm_config() succeeds
+ */
+const crm_clocks_t* crm_get_clocks(void);
+
 #endif /* CRM_H */
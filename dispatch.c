@@ -0,0 +1,110 @@
+/**
+ * Wakeup Source Dispatcher Implementation
+ */
+
+#include <stddef.h>
+#include "dispatch.h"
+#include "ramfunc.h"
+
+/**
+ * @brief Registered source, stored at its priority
+ */
+typedef struct {
+    dispatch_check_t check;
+    dispatch_handler_t handler;
+} dispatch_source_t;
+
+static dispatch_source_t dispatch_sources[DISPATCH_MAX_SOURCES];
+
+/* Priority of each registered NVIC line, and the lines/priorities in use */
+static uint8_t dispatch_irq_priority[32];
+static uint32_t dispatch_irq_mask = 0;
+static uint32_t dispatch_priority_mask = 0;
+
+/* NVIC lines pended by dispatch_pend(), untouched by the ICPR write */
+static volatile uint32_t dispatch_soft_pending = 0;
+
+/* Priority bitmap: priority 0 is bit 31, so CLZ yields the priority */
+#define DISPATCH_PRIORITY_BIT(p)    (0x80000000U >> (p))
+
+/**
+ * @brief Register a wakeup source
+ */
+dispatch_status_t dispatch_register(uint32_t priority, IRQn_Type irqn,
+                                    dispatch_check_t check, dispatch_handler_t handler) {
+    if ((priority >= DISPATCH_MAX_SOURCES) ||
+        (dispatch_priority_mask & DISPATCH_PRIORITY_BIT(priority)) || (handler == NULL)) {
+        return DISPATCH_ERR_PRIORITY;
+    }
+    if (((int32_t)irqn < 0) || ((int32_t)irqn > 31) ||
+        (dispatch_irq_mask & (1U << (uint32_t)irqn))) {
+        return DISPATCH_ERR_IRQ;
+    }
+
+    dispatch_sources[priority].check   = check;
+    dispatch_sources[priority].handler = handler;
+    dispatch_irq_priority[irqn] = (uint8_t)priority;
+
+    dispatch_priority_mask |= DISPATCH_PRIORITY_BIT(priority);
+    dispatch_irq_mask      |= 1U << (uint32_t)irqn;
+    return DISPATCH_OK;
+}
+
+/**
+ * @brief Mark a source pending in software - callable from any handler
+ */
+void dispatch_pend(IRQn_Type irqn) {
+    do {
+        /* Nested callers (the NMI) retry instead of losing bits */
+    } while (__STREXW(__LDREXW(&dispatch_soft_pending) | (1U << (uint32_t)irqn),
+                      &dispatch_soft_pending));
+    __SEV();
+}
+
+/**
+ * @brief Re-arm all registered sources and sleep until the next event
+ */
+RAMFUNC void dispatch_wait(void) {
+    /*
+     * SEVONPEND only signals a 0-to-1 transition of a pending bit, so every
+     * registered line is cleared first - in a single ICPR write. The core's
+     * event latch keeps anything that pends from here on.
+     */
+    NVIC->ICPR[0] = dispatch_irq_mask;
+    __WFE();
+}
+
+/**
+ * @brief Run the handlers of every pending source, highest priority first
+ */
+RAMFUNC uint32_t dispatch_run(void) {
+    uint32_t pending;
+    uint32_t soft;
+    uint32_t ready = 0;
+    uint32_t count = 0;
+
+    do {
+        soft = __LDREXW(&dispatch_soft_pending);
+    } while (__STREXW(0U, &dispatch_soft_pending));
+    pending = (NVIC->ISPR[0] | soft) & dispatch_irq_mask;
+
+    /* NVIC order -> priority order, one step per pending line */
+    while (pending) {
+        uint32_t irq = 31U - __CLZ(pending);
+
+        pending &= ~(1U << irq);
+        ready |= DISPATCH_PRIORITY_BIT(dispatch_irq_priority[irq]);
+    }
+
+    while (ready) {
+        uint32_t priority = __CLZ(ready);
+        const dispatch_source_t* source = &dispatch_sources[priority];
+
+        ready &= ~DISPATCH_PRIORITY_BIT(priority);
+        if ((source->check == NULL) || source->check()) {
+            source->handler();
+            count++;
+        }
+    }
+    return count;
+}
@@ -0,0 +1,100 @@
+/**
+ * Wakeup Source Dispatcher
+ *
+ * Purpose: Replace the hard-coded TMR14 check in the main loop with a table
+ *          of registered wakeup sources
+ * Features: Each source names its NVIC line, an optional flag check and a
+ *           handler; one ICPR write re-arms every source before __WFE()
+ * Performance: Pending lines are read with a single ISPR load and turned
+ *              into a priority bitmap; the next source to run is found with
+ *              one CLZ, so dispatch cost does not grow with the table
+ * Usage: Register sources once, then loop on dispatch_wait()/dispatch_run()
+ *
+ *   static uint32_t tmr14_check(void) { ... clear and return OVFIF ... }
+ *   dispatch_register(0, TMR14_GLOBAL_IRQn, tmr14_check, on_tick);
+ *
+ *   while (1) {
+ *       dispatch_wait();
+ *       dispatch_run();
+ *   }
+ *
+ * Interrupt-less Sources:
+ *   The NVIC line of a registered source stays disabled. With SEVONPEND
+ *   set, the 0-to-1 transition of its pending bit wakes __WFE(); the bit
+ *   itself tells dispatch_run() which source fired. dispatch_wait() clears
+ *   all registered pending bits in one write - a source whose peripheral
+ *   flag is still set re-pends at once, which latches a new event, so
+ *   nothing is missed between dispatch_run() and __WFE().
+ *
+ * Software Pending:
+ *   A pending bit set by software is not sticky: if it arrives after
+ *   dispatch_run() read ISPR, the ICPR write in dispatch_wait() erases it.
+ *   Handlers that cannot re-trigger their line (the NMI's clock failover)
+ *   call dispatch_pend() instead, which the dispatcher keeps until it has
+ *   run the source.
+ *
+ * Priorities:
+ *   0 (highest) to DISPATCH_MAX_SOURCES - 1, one source per priority. When
+ *   several sources are pending, higher priorities run first.
+ *
+ * Note: Only NVIC lines 0-31 can be registered (one ISPR/ICPR word).
+ */
+
+#ifndef DISPATCH_H
+#define DISPATCH_H
+
+#include "at32f421.h"
+
+#define DISPATCH_MAX_SOURCES        32U
+
+/**
+ * @brief Dispatcher operation result codes
+ */
+typedef enum {
+    DISPATCH_OK = 0,                /*!< Source registered */
+    DISPATCH_ERR_PRIORITY,          /*!< Priority out of range or already taken */
+    DISPATCH_ERR_IRQ                /*!< IRQn outside 0-31 or already registered */
+} dispatch_status_t;
+
+/**
+ * @brief Confirm and acknowledge a source - clears the peripheral flag
+ * @return Non-zero if the source really fired
+ */
+typedef uint32_t (*dispatch_check_t)(void);
+
+/**
+ * @brief Work to do for a source, called in thread context
+ */
+typedef void (*dispatch_handler_t)(void);
+
+/**
+ * @brief Register a wakeup source
+ * @param priority 0 (highest) to DISPATCH_MAX_SOURCES - 1
+ * @param irqn     NVIC line whose pending bit signals the source
+ * @param check    Flag check, or NULL if the pending bit is enough
+ * @param handler  Called when the source fired
+ * @return DISPATCH_OK or the reason for rejection
+ */
+dispatch_status_t dispatch_register(uint32_t priority, IRQn_Type irqn,
+                                    dispatch_check_t check, dispatch_handler_t handler);
+
+/**
+ * @brief Mark a source pending in software - callable from any handler
+ * @param irqn NVIC line the source was registered with
+ *
+ * Survives dispatch_wait() and wakes a pending __WFE() with __SEV().
+ */
+void dispatch_pend(IRQn_Type irqn);
+
+/**
+ * @brief Re-arm all registered sources and sleep until the next event
+ */
+void dispatch_wait(void);
+
+/**
+ * @brief Run the handlers of every pending source, highest priority first
+ * @return Number of handlers run (0 = the wakeup came from elsewhere)
+ */
+uint32_t dispatch_run(void);
+
+#endif /* DISPATCH_H */
@@ -0,0 +1,91 @@
+/**
+ * Interrupt-to-Main-Loop Event Queue Implementation
+ */
+
+#include <stddef.h>
+#include "at32f421.h"
+#include "event.h"
+#include "ramfunc.h"
+
+#define EVENT_QUEUE_MASK            (EVENT_QUEUE_SIZE - 1U)
+
+/* Free-running indices: head is reserved by producers, tail is owned by
+ * the consumer. Their difference is the fill level. */
+static event_t event_queue[EVENT_QUEUE_SIZE];
+static volatile uint32_t event_head = 0;
+static volatile uint32_t event_tail = 0;
+
+static volatile uint32_t event_dropped = 0;
+static uint32_t event_max_batch = 0;
+static event_stats_t event_stats_snapshot;
+
+static event_handler_t event_handlers[EVENT_TYPE_COUNT];
+
+/**
+ * @brief Set the handler for one event type (NULL discards the type)
+ */
+void event_register(event_type_t type, event_handler_t handler) {
+    if ((uint32_t)type < EVENT_TYPE_COUNT) {
+        event_handlers[type] = handler;
+    }
+}
+
+/**
+ * @brief Queue an event - callable from any interrupt priority
+ */
+RAMFUNC uint32_t event_post(event_type_t type, uint32_t data) {
+    uint32_t head;
+
+    do {
+        head = __LDREXW(&event_head);
+        if ((head - event_tail) >= EVENT_QUEUE_SIZE) {
+            __CLREX();
+            do {
+                /* Nested producers may count at the same time */
+            } while (__STREXW(__LDREXW(&event_dropped) + 1U, &event_dropped));
+            return 0U;
+        }
+    } while (__STREXW(head + 1U, &event_head));
+
+    event_queue[head & EVENT_QUEUE_MASK].type = (uint32_t)type;
+    event_queue[head & EVENT_QUEUE_MASK].data = data;
+    return 1U;
+}
+
+/**
+ * @brief Service every queued event, including ones posted meanwhile
+ */
+RAMFUNC uint32_t event_dispatch(void) {
+    uint32_t tail = event_tail;
+    uint32_t count = 0;
+
+    while (tail != event_head) {
+        const event_t* event = &event_queue[tail & EVENT_QUEUE_MASK];
+        event_handler_t handler = (event->type < EVENT_TYPE_COUNT) ?
+                                  event_handlers[event->type] : NULL;
+
+        if (handler != NULL) {
+            handler(event);
+        }
+
+        /* Release the slot only after the handler has read it */
+        event_tail = ++tail;
+        count++;
+    }
+
+    if (count > event_max_batch) {
+        event_max_batch = count;
+    }
+    return count;
+}
+
+/**
+ * @brief Queue statistics since reset
+ */
+const event_stats_t* event_stats(void) {
+    event_stats_snapshot.posted     = event_head;
+    event_stats_snapshot.dispatched = event_tail;
+    event_stats_snapshot.dropped    = event_dropped;
+    event_stats_snapshot.max_batch  = event_max_batch;
+    return &event_stats_snapshot;
+}
@@ -0,0 +1,104 @@
+/**
+ * Interrupt-to-Main-Loop Event Queue
+ *
+ * Purpose: Carry typed events from interrupt handlers to the __WFE() main
+ *          loop, so every wakeup source delivers its payload
+ * Features: Wait-free posting from any interrupt priority, batch draining,
+ *           O(1) dispatch through a per-type handler table
+ * Performance: event_post() is a LDREX/STREX index reservation plus two
+ *              stores; event_dispatch() costs one table lookup per event
+ * Usage: Register handlers once, post from interrupts, drain after __WFE()
+ *
+ *   event_register(EVENT_RX_FRAME, on_rx_frame);
+ *   ...
+ *   __WFE();
+ *   event_dispatch();
+ *
+ * Configuration Options:
+ *   • EVENT_QUEUE_SIZE: Queue depth, power of two (default: 16)
+ *
+ * Concurrency Model:
+ *   Producers are interrupt handlers of any priority (and thread code);
+ *   the single consumer is thread code. A producer reserves a slot by
+ *   advancing the head index with LDREX/STREX, then fills it. A handler
+ *   that preempts another producer between reservation and fill runs to
+ *   completion before that producer resumes, and thread code only runs once
+ *   every active handler has returned - so every slot below the head the
+ *   consumer sees is already filled, and no lock is needed.
+ *
+ * Note: Handlers run in thread context and may post further events; those
+ *       are serviced in the same event_dispatch() call.
+ */
+
+#ifndef EVENT_H
+#define EVENT_H
+
+#include <stdint.h>
+
+#ifndef EVENT_QUEUE_SIZE
+  #define EVENT_QUEUE_SIZE            16U
+#endif
+
+#if (EVENT_QUEUE_SIZE < 2U) || ((EVENT_QUEUE_SIZE & (EVENT_QUEUE_SIZE - 1U)) != 0U)
+  #error "EVENT_QUEUE_SIZE must be a power of two"
+#endif
+
+/**
+ * @brief Event types - index into the handler table
+ */
+typedef enum {
+    EVENT_TIMER_TICK = 0,           /*!< Periodic timer expired, data = tick count */
+    EVENT_RX_FRAME,                 /*!< USART1 frame received, data = length */
+    EVENT_TX_DONE,                  /*!< USART1 transmit queue drained */
+    EVENT_GPIO_EDGE,                /*!< External line edge, data = line mask */
+    EVENT_TYPE_COUNT
+} event_type_t;
+
+/**
+ * @brief Queued event
+ */
+typedef struct {
+    uint32_t type;                  /*!< event_type_t */
+    uint32_t data;                  /*!< Type-specific payload */
+} event_t;
+
+/**
+ * @brief Event handler, called in thread context
+ */
+typedef void (*event_handler_t)(const event_t* event);
+
+/**
+ * @brief Queue statistics
+ */
+typedef struct {
+    uint32_t posted;                /*!< Events accepted by event_post() */
+    uint32_t dispatched;            /*!< Events taken off the queue */
+    uint32_t dropped;               /*!< Events lost because the queue was full */
+    uint32_t max_batch;             /*!< Most events serviced by one event_dispatch() */
+} event_stats_t;
+
+/**
+ * @brief Set the handler for one event type (NULL discards the type)
+ */
+void event_register(event_type_t type, event_handler_t handler);
+
+/**
+ * @brief Queue an event - callable from any interrupt priority
+ * @param type Event type
+ * @param data Payload
+ * @return 1 if queued, 0 if the queue was full (the event is counted as dropped)
+ */
+uint32_t event_post(event_type_t type, uint32_t data);
+
+/**
+ * @brief Service every queued event, including ones posted meanwhile
+ * @return Number of events serviced
+ */
+uint32_t event_dispatch(void);
+
+/**
+ * @brief Queue statistics since reset
+ */
+const event_stats_t* event_stats(void);
+
+#endif /* EVENT_H */
@@ -0,0 +1,251 @@
+/**
+ * Division-Free Number Formatting Implementation
+ *
+ * Every quotient is computed as (x * M) >> s with constants that are exact
+ * for the whole input range, so the compiler emits UMULL instead of UDIV
+ * (which it would otherwise prefer at -Os). The two-digit table halves the
+ * number of multiply steps. The decimal path runs from SRAM (ramfunc.h).
+ */
+
+#include "fmt.h"
+#include "ramfunc.h"
+
+/* Exact quotients for any 32-bit x */
+#define DIV10(x)                    ((uint32_t)(((uint64_t)(x) * 0xCCCCCCCDU) >> 35))
+#define DIV100(x)                   ((uint32_t)(((uint64_t)(x) * 0x51EB851FU) >> 37))
+
+/* Exact 64-bit quotient by 10^8: high half of x * M, shifted */
+#define DIV1E8_MAGIC                0xABCC77118461CEFDULL
+#define DIV1E8_SHIFT                26U
+
+static const char digit_pairs[200] = {
+    '0','0','0','1','0','2','0','3','0','4','0','5','0','6','0','7','0','8','0','9',
+    '1','0','1','1','1','2','1','3','1','4','1','5','1','6','1','7','1','8','1','9',
+    '2','0','2','1','2','2','2','3','2','4','2','5','2','6','2','7','2','8','2','9',
+    '3','0','3','1','3','2','3','3','3','4','3','5','3','6','3','7','3','8','3','9',
+    '4','0','4','1','4','2','4','3','4','4','4','5','4','6','4','7','4','8','4','9',
+    '5','0','5','1','5','2','5','3','5','4','5','5','5','6','5','7','5','8','5','9',
+    '6','0','6','1','6','2','6','3','6','4','6','5','6','6','6','7','6','8','6','9',
+    '7','0','7','1','7','2','7','3','7','4','7','5','7','6','7','7','7','8','7','9',
+    '8','0','8','1','8','2','8','3','8','4','8','5','8','6','8','7','8','8','8','9',
+    '9','0','9','1','9','2','9','3','9','4','9','5','9','6','9','7','9','8','9','9'
+};
+
+static const uint32_t pow10_table[10] = {
+    1U, 10U, 100U, 1000U, 10000U,
+    100000U, 1000000U, 10000000U, 100000000U, 1000000000U
+};
+
+static const char hex_digits[16] = {
+    '0','1','2','3','4','5','6','7','8','9','A','B','C','D','E','F'
+};
+
+/**
+ * @brief Number of decimal digits in value (1-10)
+ */
+RAMFUNC static uint32_t count_digits(uint32_t value) {
+    uint32_t n = 1;
+
+    while ((n < 10U) && (value >= pow10_table[n])) {
+        n++;
+    }
+    return n;
+}
+
+/**
+ * @brief Write exactly n digits of value, ending just before end
+ *
+ * Leading positions are zero-filled, so this also serves the fixed-width
+ * chunks of fmt_u64() and the fraction of fmt_q().
+ */
+RAMFUNC static void put_digits(char* end, uint32_t value, uint32_t n) {
+    while (n >= 2U) {
+        uint32_t q = DIV100(value);
+        const char* pair = &digit_pairs[(value - q * 100U) * 2U];
+
+        *--end = pair[1];
+        *--end = pair[0];
+        value = q;
+        n -= 2U;
+    }
+    if (n) {
+        *--end = (char)('0' + (value - DIV10(value) * 10U));
+    }
+}
+
+/**
+ * @brief High 64 bits of a 64x64 product, built from 32x32 UMULLs
+ */
+static uint64_t mul_hi64(uint64_t a, uint64_t b) {
+    uint32_t a_lo = (uint32_t)a, a_hi = (uint32_t)(a >> 32);
+    uint32_t b_lo = (uint32_t)b, b_hi = (uint32_t)(b >> 32);
+    uint64_t lo_lo = (uint64_t)a_lo * b_lo;
+    uint64_t mid1  = (uint64_t)a_hi * b_lo + (lo_lo >> 32);
+    uint64_t mid2  = (uint64_t)a_lo * b_hi + (uint32_t)mid1;
+
+    return (uint64_t)a_hi * b_hi + (mid1 >> 32) + (mid2 >> 32);
+}
+
+/**
+ * @brief Exact value / 10^8 for any 64-bit value
+ */
+static uint64_t div_1e8(uint64_t value) {
+    return mul_hi64(value, DIV1E8_MAGIC) >> DIV1E8_SHIFT;
+}
+
+/**
+ * @brief Format an unsigned 32-bit value as decimal
+ */
+RAMFUNC uint32_t fmt_u32(char* dst, uint32_t value) {
+    uint32_t n = count_digits(value);
+
+    put_digits(dst + n, value, n);
+    return n;
+}
+
+/**
+ * @brief Format a signed 32-bit value as decimal
+ */
+uint32_t fmt_i32(char* dst, int32_t value) {
+    if (value < 0) {
+        *dst = '-';
+        return 1U + fmt_u32(dst + 1, 0U - (uint32_t)value);
+    }
+    return fmt_u32(dst, (uint32_t)value);
+}
+
+/**
+ * @brief Format an unsigned 64-bit value as decimal
+ */
+uint32_t fmt_u64(char* dst, uint64_t value) {
+    uint64_t upper;
+    uint32_t low, n;
+
+    if ((value >> 32) == 0U) {
+        return fmt_u32(dst, (uint32_t)value);
+    }
+
+    /* value = upper * 10^8 + low, upper < 2^38 */
+    upper = div_1e8(value);
+    low = (uint32_t)(value - upper * 100000000U);
+
+    if ((upper >> 32) == 0U) {
+        n = fmt_u32(dst, (uint32_t)upper);
+    } else {
+        /* upper = top * 10^8 + mid, top <= 1844 */
+        uint64_t top = div_1e8(upper);
+        uint32_t mid = (uint32_t)(upper - top * 100000000U);
+
+        n = fmt_u32(dst, (uint32_t)top);
+        put_digits(dst + n + 8U, mid, 8U);
+        n += 8U;
+    }
+
+    put_digits(dst + n + 8U, low, 8U);
+    return n + 8U;
+}
+
+/**
+ * @brief Format an unsigned 32-bit value right-aligned in a field
+ */
+RAMFUNC uint32_t fmt_u32_pad(char* dst, uint32_t value, uint32_t width, char pad) {
+    uint32_t n = count_digits(value);
+    uint32_t fill = 0;
+
+    if (width > n) {
+        fill = width - n;
+        for (uint32_t i = 0; i < fill; i++) {
+            dst[i] = pad;
+        }
+    }
+    put_digits(dst + fill + n, value, n);
+    return fill + n;
+}
+
+/**
+ * @brief Format a signed 32-bit value right-aligned in a field
+ */
+uint32_t fmt_i32_pad(char* dst, int32_t value, uint32_t width, char pad) {
+    uint32_t magnitude = (value < 0) ? (0U - (uint32_t)value) : (uint32_t)value;
+    uint32_t digits = count_digits(magnitude);
+    uint32_t n = digits + ((value < 0) ? 1U : 0U);
+    uint32_t fill = (width > n) ? (width - n) : 0U;
+    uint32_t i = 0;
+
+    if (pad != '0') {
+        while (i < fill) {
+            dst[i++] = pad;
+        }
+    }
+    if (value < 0) {
+        dst[i++] = '-';
+    }
+    if (pad == '0') {
+        for (uint32_t z = 0; z < fill; z++) {
+            dst[i++] = '0';
+        }
+    }
+    put_digits(dst + i + digits, magnitude, digits);
+    return i + digits;
+}
+
+/**
+ * @brief Format an unsigned 32-bit value as upper-case hexadecimal
+ */
+uint32_t fmt_hex(char* dst, uint32_t value, uint32_t digits) {
+    if (digits == 0U) {
+        digits = 1U;
+        while ((digits < 8U) && (value >> (digits * 4U))) {
+            digits++;
+        }
+    } else if (digits > 8U) {
+        digits = 8U;
+    }
+
+    for (uint32_t i = digits; i > 0; i--) {
+        dst[i - 1U] = hex_digits[value & 0xFU];
+        value >>= 4;
+    }
+    return digits;
+}
+
+/**
+ * @brief Format a signed Q-format fixed-point value as decimal
+ */
+uint32_t fmt_q(char* dst, int32_t value, uint32_t frac_bits, uint32_t decimals) {
+    uint32_t magnitude = (value < 0) ? (0U - (uint32_t)value) : (uint32_t)value;
+    uint32_t integer, fraction, n = 0;
+
+    if (decimals > FMT_Q_DECIMALS_MAX) {
+        decimals = FMT_Q_DECIMALS_MAX;
+    }
+
+    if (frac_bits == 0U) {
+        integer  = magnitude;
+        fraction = 0;
+    } else {
+        uint64_t scaled = (uint64_t)(magnitude & ((1U << frac_bits) - 1U)) * pow10_table[decimals];
+
+        /* Round half up on the last printed decimal */
+        scaled += (uint64_t)1U << (frac_bits - 1U);
+        integer  = magnitude >> frac_bits;
+        fraction = (uint32_t)(scaled >> frac_bits);
+
+        if (fraction >= pow10_table[decimals]) {
+            fraction -= pow10_table[decimals];
+            integer++;
+        }
+    }
+
+    if ((value < 0) && ((integer | fraction) != 0U)) {
+        dst[n++] = '-';
+    }
+    n += fmt_u32(dst + n, integer);
+
+    if (decimals) {
+        dst[n++] = '.';
+        put_digits(dst + n + decimals, fraction, decimals);
+        n += decimals;
+    }
+    return n;
+}
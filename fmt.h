@@ -0,0 +1,115 @@
+/**
+ * Division-Free Number Formatting
+ *
+ * Purpose: Convert integers and fixed-point values to text without UDIV
+ * Features: Reciprocal multiplication and a two-digit lookup table
+ * Performance: Digits are written left to right straight into the caller's
+ *              buffer - no reverse pass, no terminator, no second copy
+ * Usage: Pass a buffer with at least the FMT_*_MAX bytes for the call; the
+ *        functions return the number of characters written
+ *
+ * Supported Conversions:
+ *   • fmt_u32 / fmt_i32      - decimal
+ *   • fmt_u64                - decimal, 64-bit (split into 10^8 chunks)
+ *   • fmt_u32_pad            - right-aligned in a fixed width (space/zero pad)
+ *   • fmt_i32_pad            - signed, right-aligned; zero padding follows the sign
+ *   • fmt_hex                - upper-case hexadecimal, fixed or minimal width
+ *   • fmt_q                  - signed Q-format fixed point, rounded
+ *
+ * Key Features:
+ *   ✓ No division instruction: /10, /100 and /10^8 use UMULL
+ *   ✓ Two digits per step from a 200-byte table
+ *   ✓ Output is not NUL-terminated, lengths are returned instead
+ *   ✓ No standard library dependencies
+ *
+ * Example Usage:
+ *   char buf[FMT_Q_MAX];
+ *   uint32_t n = fmt_q(buf, temp_q8, 8, 2);   // "-12.75"
+ *   usart_write(buf, n);
+ */
+
+#ifndef FMT_H
+#define FMT_H
+
+#include <stdint.h>
+
+/* Worst-case output lengths in characters */
+#define FMT_U32_MAX                 10U
+#define FMT_I32_MAX                 11U
+#define FMT_U64_MAX                 20U
+#define FMT_HEX_MAX                 8U
+#define FMT_Q_MAX                   (FMT_I32_MAX + 1U + FMT_Q_DECIMALS_MAX)
+
+/* Largest number of fractional digits fmt_q() produces */
+#define FMT_Q_DECIMALS_MAX          9U
+
+/**
+ * @brief Format an unsigned 32-bit value as decimal
+ * @param dst   Output buffer, at least FMT_U32_MAX bytes
+ * @param value Value to format
+ * @return Number of characters written
+ */
+uint32_t fmt_u32(char* dst, uint32_t value);
+
+/**
+ * @brief Format a signed 32-bit value as decimal
+ * @param dst   Output buffer, at least FMT_I32_MAX bytes
+ * @param value Value to format
+ * @return Number of characters written
+ */
+uint32_t fmt_i32(char* dst, int32_t value);
+
+/**
+ * @brief Format an unsigned 64-bit value as decimal
+ * @param dst   Output buffer, at least FMT_U64_MAX bytes
+ * @param value Value to format
+ * @return Number of characters written
+ */
+uint32_t fmt_u64(char* dst, uint64_t value);
+
+/**
+ * @brief Format an unsigned 32-bit value right-aligned in a field
+ * @param dst   Output buffer, at least max(width, FMT_U32_MAX) bytes
+ * @param value Value to format
+ * @param width Minimum field width; wider values are not truncated
+ * @param pad   Fill character, typically ' ' or '0'
+ * @return Number of characters written
+ */
+uint32_t fmt_u32_pad(char* dst, uint32_t value, uint32_t width, char pad);
+
+/**
+ * @brief Format a signed 32-bit value right-aligned in a field
+ *
+ * Space padding goes before the sign ("  -42"), zero padding after it
+ * ("-0042"), as printf() does.
+ * @param dst   Output buffer, at least max(width, FMT_I32_MAX) bytes
+ * @param value Value to format
+ * @param width Minimum field width, sign included; wider values are not truncated
+ * @param pad   Fill character, typically ' ' or '0'
+ * @return Number of characters written
+ */
+uint32_t fmt_i32_pad(char* dst, int32_t value, uint32_t width, char pad);
+
+/**
+ * @brief Format an unsigned 32-bit value as upper-case hexadecimal
+ * @param dst    Output buffer, at least FMT_HEX_MAX bytes
+ * @param value  Value to format
+ * @param digits Number of digits (1-8), or 0 for the minimal width
+ * @return Number of characters written
+ */
+uint32_t fmt_hex(char* dst, uint32_t value, uint32_t digits);
+
+/**
+ * @brief Format a signed Q-format fixed-point value as decimal
+ *
+ * The value represents value / 2^frac_bits. The fraction is rounded to
+ * the requested number of decimals, carrying into the integer part.
+ * @param dst       Output buffer, at least FMT_Q_MAX bytes
+ * @param value     Fixed-point value
+ * @param frac_bits Number of fractional bits (0-31)
+ * @param decimals  Digits after the decimal point (0-FMT_Q_DECIMALS_MAX)
+ * @return Number of characters written
+ */
+uint32_t fmt_q(char* dst, int32_t value, uint32_t frac_bits, uint32_t decimals);
+
+#endif /* FMT_H */
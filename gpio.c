@@ -7,11 +7,14 @@
  *         it is called once, immediately after a hardware reset.
  */
 #include "gpio.h"
+#include "crm.h"
 
 /**
  * @brief  Configures all GPIO pins on port A for their specific functions.
  */
 void gpio_config(void) {
+    (void)crm_periph_acquire(CRM_PERIPH_GPIOA);
+
     // --- GPIOA Mode Register (CFGR) ---
     // Direct write. Sets application and SWD pins to Alternate Function,
     // and all other pins on the port to Analog Mode for low power.
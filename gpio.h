@@ -3,17 +3,17 @@
  * 
  * Purpose: Single function to configure all GPIO pins used in the project
  * Features: Direct register access with named constants for maximum efficiency
- * Usage: Call gpio_config() once after enabling GPIOA clock
+ * Usage: Call gpio_config() once; it acquires the GPIOA clock itself
  * 
  * Configured Pins:
  *   • PA4  - TMR14_CH1 (AF4) - PWM output
  *   • PA9  - USART1_TX (AF1) - Serial transmit
  *   • PA10 - USART1_RX (AF1) - Serial receive
+ *                              (AF2 TMR1_CH3 while autobaud measures)
  *   • PA13 - SWDIO (AF0)     - Preserved for debugging
  *   • PA14 - SWCLK (AF0)     - Preserved for debugging
  * 
  * Note: All other pins on Port A are set to Analog mode for lowest power consumption.
- *       GPIO clocks must be enabled before calling gpio_config().
  */
 
 #ifndef GPIO_H
@@ -28,6 +28,7 @@
 #define GPIO_PULL_DOWN        0x2U
 #define GPIO_AF0_SYSTEM       0x0U // JTAG/SWD
 #define GPIO_AF1_USART        0x1U
+#define GPIO_AF2_TIMER        0x2U
 #define GPIO_AF4_TIMER        0x4U
 
 // --- Pin-Specific Configuration Constants for GPIOA ---
@@ -56,7 +57,9 @@
 #define GPIO_PA10_PULL_Pos    (10 * 2)
 #define GPIO_PA10_PULL_UP     (GPIO_PULL_UP << GPIO_PA10_PULL_Pos)
 #define GPIO_PA10_MUXH_Pos    ((10 - 8) * 4)
+#define GPIO_PA10_MUXH_Msk    (0xFU << GPIO_PA10_MUXH_Pos)
 #define GPIO_PA10_MUXH_AF1    (GPIO_AF1_USART << GPIO_PA10_MUXH_Pos)
+#define GPIO_PA10_MUXH_AF2    (GPIO_AF2_TIMER << GPIO_PA10_MUXH_Pos)  // TMR1_CH3 (autobaud)
 
 // PA13 (SWDIO)
 #define GPIO_PA13_CFGR_Pos    (13 * 2)
@@ -0,0 +1,366 @@
+/**
+ * Idle Governor Implementation
+ */
+
+#include "idle.h"
+#include "crm.h"
+#include "dispatch.h"
+#include "swtimer.h"
+#include "systime.h"
+#include "timer.h"
+#include "usart.h"
+
+static idle_stats_t stats;
+
+#if IDLE_DEEP_MODES
+
+/**
+ * @brief Remove the ERTC register write protection
+ */
+static void ertc_unlock(void) {
+    ERTC->wp = ERTC_WP_KEY1;
+    ERTC->wp = ERTC_WP_KEY2;
+}
+
+/**
+ * @brief Restore the ERTC register write protection
+ */
+static void ertc_lock(void) {
+    ERTC->wp = ERTC_WP_LOCK;
+}
+
+/**
+ * @brief Sub-second counter (counts down at the ERTC clock)
+ */
+static uint32_t ertc_sbs_read(void) {
+    uint32_t a, b = ERTC->sbs;
+
+    /* Shadow registers are bypassed, so the counter may change under the
+     * read - take it once two samples agree */
+    do {
+        a = b;
+        b = ERTC->sbs;
+    } while (a != b);
+    return a & ERTC_SBS_MASK;
+}
+
+/**
+ * @brief Wait for the sub-second counter to step
+ * @param sbs Receives the new value
+ * @return 0 if it did not step within 1ms (ERTC not running)
+ */
+static uint32_t ertc_sbs_edge(uint32_t* sbs) {
+    uint32_t first = ertc_sbs_read();
+    uint32_t start = time_now_us32();
+
+    while ((*sbs = ertc_sbs_read()) == first) {
+        if ((uint32_t)(time_now_us32() - start) > 1000U) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief Convert ERTC clocks to microseconds at the calibrated rate
+ */
+static uint32_t ertc_to_us(uint32_t clocks) {
+    return (uint32_t)(((uint64_t)clocks * 1000000U) / stats.ertc_hz);
+}
+
+/**
+ * @brief Start LICK (or LEXT) and select it as the ERTC clock
+ */
+static idle_status_t ertc_clock_start(void) {
+    uint32_t timeout = IDLE_LOW_CLOCK_TIMEOUT;
+#if IDLE_ERTC_LEXT
+    const uint32_t sel = CRM_BPDC_ERTCSEL_LEXT;
+#else
+    const uint32_t sel = CRM_BPDC_ERTCSEL_LICK;
+
+    CRM->ctrlsts |= CRM_CTRLSTS_LICKEN;
+    while (!(CRM->ctrlsts & CRM_CTRLSTS_LICKSTBL)) {
+        if (--timeout == 0) {
+            return IDLE_ERR_CLOCK;
+        }
+    }
+#endif
+
+    PWC->ctrl |= PWC_CTRL_BPWEN;
+
+    /* The ERTC clock source can only be changed by resetting the domain */
+    if ((CRM->bpdc & CRM_BPDC_ERTCSEL_Msk) != sel) {
+        CRM->bpdc |= CRM_BPDC_BPDRST;
+        CRM->bpdc &= ~CRM_BPDC_BPDRST;
+    }
+
+#if IDLE_ERTC_LEXT
+    CRM->bpdc |= CRM_BPDC_LEXTEN;
+    while (!(CRM->bpdc & CRM_BPDC_LEXTSTBL)) {
+        if (--timeout == 0) {
+            return IDLE_ERR_CLOCK;
+        }
+    }
+#endif
+
+    CRM->bpdc |= sel | CRM_BPDC_ERTCEN;
+    return IDLE_OK;
+}
+
+/**
+ * @brief Run the sub-second counter at the full ERTC clock, wakeup timer off
+ */
+static idle_status_t ertc_setup(void) {
+    uint32_t timeout = IDLE_LOW_CLOCK_TIMEOUT;
+
+    ertc_unlock();
+
+    /* The wakeup clock may only be changed with the timer stopped */
+    ERTC->ctrl = ERTC_CTRL_BPSH;
+    while (!(ERTC->sts & ERTC_STS_WATWF)) {
+        if (--timeout == 0) {
+            ertc_lock();
+            return IDLE_ERR_CLOCK;
+        }
+    }
+    ERTC->ctrl = ERTC_CTRL_BPSH | ERTC_CTRL_WATCLK_DIV2;
+
+    /* Prescalers are only writable in initialization mode */
+    ERTC->sts |= ERTC_STS_IMEN;
+    while (!(ERTC->sts & ERTC_STS_IMF)) {
+        if (--timeout == 0) {
+            ertc_lock();
+            return IDLE_ERR_CLOCK;
+        }
+    }
+    ERTC->div = (0U << ERTC_DIV_DIVA_Pos) | (ERTC_DIV_DIVB_SUBSECOND << ERTC_DIV_DIVB_Pos);
+    ERTC->sts &= ~ERTC_STS_IMEN;
+
+    ertc_lock();
+    return IDLE_OK;
+}
+
+/**
+ * @brief Measure the ERTC clock against the microsecond clock
+ * @return ERTC clock in Hz, 0 if it is not running
+ */
+static uint32_t ertc_calibrate(void) {
+    uint32_t s0, s1;
+    uint64_t t0, t1;
+
+    /* Start and end on counter steps, so the count is exact */
+    if (!ertc_sbs_edge(&s0)) {
+        return 0;
+    }
+    t0 = time_now_us();
+    while ((time_now_us() - t0) < IDLE_ERTC_CAL_US) {
+        /* Let enough clocks pass for 0.025% resolution on LICK */
+    }
+    if (!ertc_sbs_edge(&s1)) {
+        return 0;
+    }
+    t1 = time_now_us();
+
+    return (uint32_t)((((uint64_t)((s0 - s1) & ERTC_SBS_MASK) * 1000000U) + ((t1 - t0) / 2U)) /
+                      (t1 - t0));
+}
+
+/**
+ * @brief Start the ERTC wakeup timer
+ * @param us Time to sleep
+ * @return Programmed time in ERTC clocks, 0 if too short to program
+ */
+static uint32_t ertc_wake_arm(uint32_t us) {
+    uint32_t ticks = (uint32_t)(((uint64_t)us * stats.ertc_hz) / (1000000U * IDLE_WAT_DIV));
+
+    if (ticks == 0U) {
+        return 0;
+    }
+    if (ticks > 0x10000U) {
+        ticks = 0x10000U;
+    }
+
+    ertc_unlock();
+    while (!(ERTC->sts & ERTC_STS_WATWF)) {
+        /* Set two ERTC clocks after the last disarm - normally long ago */
+    }
+    ERTC->wat  = ticks - 1U;
+    ERTC->sts &= ~ERTC_STS_WATF;
+    ERTC->ctrl |= ERTC_CTRL_WATEN | ERTC_CTRL_WATIEN;
+    ertc_lock();
+
+    return ticks * IDLE_WAT_DIV;
+}
+
+/**
+ * @brief Stop the ERTC wakeup timer
+ * @return Non-zero if it had elapsed
+ */
+static uint32_t ertc_wake_disarm(void) {
+    uint32_t elapsed = ERTC->sts & ERTC_STS_WATF;
+
+    ertc_unlock();
+    ERTC->ctrl &= ~(ERTC_CTRL_WATEN | ERTC_CTRL_WATIEN);
+    ERTC->sts  &= ~ERTC_STS_WATF;
+    ertc_lock();
+    EXINT->intsts = IDLE_EXINT_LINE;
+
+    return elapsed;
+}
+
+/**
+ * @brief Fold one latency measurement into the mode's statistics
+ */
+static void latency_update(idle_mode_t mode, uint32_t us) {
+    uint32_t avg = stats.latency_us[mode];
+
+    /* Exponential average over about eight wakes; the first one seeds it */
+    stats.latency_us[mode] = avg ? ((avg * 7U + us) / 8U) : us;
+    if (us > stats.latency_max_us[mode]) {
+        stats.latency_max_us[mode] = us;
+    }
+}
+
+/**
+ * @brief Time until the next event that needs the CPU
+ */
+static uint32_t idle_predict_us(void) {
+    uint32_t us = timer_next_tick_us();
+    uint32_t ms = swtimer_next_ms();
+
+    /* Wheel time is truncated to whole milliseconds - assume the worst */
+    if ((ms != SWTIMER_NEXT_NONE) && (ms < us / 1000U)) {
+        us = ms ? (ms - 1U) * 1000U : 0U;
+    }
+    return us;
+}
+
+/**
+ * @brief Non-zero if a deep mode pays off for the predicted idle time
+ */
+static uint32_t idle_fits(idle_mode_t mode, uint32_t idle_us, uint32_t min_us) {
+    return (idle_us >= min_us) && (idle_us >= stats.latency_us[mode] * IDLE_LATENCY_MARGIN);
+}
+
+/**
+ * @brief Sleep in a deep mode, then restore clocks and timekeeping
+ */
+static void idle_deep(idle_mode_t mode, uint32_t idle_us) {
+    uint32_t sclk_hz = crm_get_clocks()->sclk_hz;
+    uint32_t on_pll = (CRM->cfg & CRM_CFG_SCLKSTS_Msk) == CRM_CFG_SCLKSTS_PLL;
+    uint32_t planned, start, spent;
+
+    planned = ertc_wake_arm(idle_us - stats.latency_us[mode] - IDLE_WAKE_GUARD_US);
+    if (planned == 0U) {
+        dispatch_wait();
+        stats.entries[IDLE_MODE_SLEEP]++;
+        return;
+    }
+
+    PWC->ctrl = (PWC->ctrl & ~(PWC_CTRL_VRSEL | PWC_CTRL_LPSEL)) |
+                ((mode == IDLE_MODE_STOP) ? PWC_CTRL_VRSEL : 0U);
+
+    start = ertc_sbs_read();
+    SCB->SCR |= SCB_SCR_SLEEPDEEP_Msk;
+    dispatch_wait();
+    SCB->SCR &= ~SCB_SCR_SLEEPDEEP_Msk;
+
+    /* The core wakes on HICK - bring the PLL back first, then return to
+     * a frequency chosen with crm_set_sysclk(). If __WFE() returned without
+     * sleeping, the PLL still runs the core and must not be touched. */
+    if (on_pll && ((CRM->cfg & CRM_CFG_SCLKSTS_Msk) != CRM_CFG_SCLKSTS_PLL)) {
+        crm_status_t status = crm_config();
+
+        if ((status == CRM_OK) && (sclk_hz != SYSTEM_CLOCK_HZ)) {
+            status = crm_set_sysclk(sclk_hz);
+        }
+        if (status != CRM_OK) {
+            /* Drivers must not keep timing against PLL clocks */
+            stats.restore_failures++;
+            crm_clocks_sync();
+        }
+    }
+
+    spent = (start - ertc_sbs_read()) & ERTC_SBS_MASK;
+    if (ertc_wake_disarm()) {
+        /* Everything past the programmed time is wakeup latency. The
+         * wakeup timer's divider phase can end the sleep a clock early,
+         * which shows up as a huge value and counts as none. */
+        uint32_t late = (spent - planned) & ERTC_SBS_MASK;
+
+        if (late > (ERTC_SBS_MASK / 2U)) {
+            late = 0;
+        }
+        spent = planned + late;
+        latency_update(mode, ertc_to_us(late));
+    } else {
+        /* An event was already latched - __WFE() returned at once */
+        stats.early_wakes++;
+    }
+    stats.entries[mode]++;
+
+    /* The timers stood still meanwhile; they ran at a fraction of their
+     * rate during the PLL restart, which is left uncorrected */
+    idle_us = ertc_to_us(spent);
+    time_advance_us(idle_us);
+    swtimer_advance_us(idle_us);
+    timer_advance_us(idle_us);
+}
+
+#endif /* IDLE_DEEP_MODES */
+
+/**
+ * @brief Start the ERTC wakeup path and calibrate its clock
+ */
+idle_status_t idle_init(void) {
+#if IDLE_DEEP_MODES
+    /* PWC stays clocked: deep-sleep entry and battery-domain access */
+    (void)crm_periph_acquire(CRM_PERIPH_PWC);
+
+    if ((ertc_clock_start() != IDLE_OK) || (ertc_setup() != IDLE_OK)) {
+        return IDLE_ERR_CLOCK;
+    }
+
+    /* Wakeup timer as a rising-edge event: ends __WFE(), no handler */
+    EXINT->polcfg1 |= IDLE_EXINT_LINE;
+    EXINT->evten   |= IDLE_EXINT_LINE;
+
+    stats.ertc_hz = ertc_calibrate();
+    if (stats.ertc_hz == 0U) {
+        return IDLE_ERR_CLOCK;
+    }
+#endif
+    return IDLE_OK;
+}
+
+/**
+ * @brief Sleep until the next wakeup, as deeply as the next event allows
+ */
+void idle_sleep(void) {
+#if IDLE_DEEP_MODES
+    /* Deep modes stop USART1 - only enter them with the line idle. They
+     * also restart the PLL, which a staged boot may still be bringing up. */
+    if ((stats.ertc_hz != 0U) && !usart_tx_busy() && (USART1->sts & USART_STS_TDC) &&
+        !crm_boot_pending()) {
+        uint32_t idle_us = idle_predict_us();
+
+        if (idle_fits(IDLE_MODE_STOP, idle_us, IDLE_STOP_MIN_US)) {
+            idle_deep(IDLE_MODE_STOP, idle_us);
+            return;
+        }
+        if (idle_fits(IDLE_MODE_DEEPSLEEP, idle_us, IDLE_DEEPSLEEP_MIN_US)) {
+            idle_deep(IDLE_MODE_DEEPSLEEP, idle_us);
+            return;
+        }
+    }
+#endif
+    dispatch_wait();
+    stats.entries[IDLE_MODE_SLEEP]++;
+}
+
+/**
+ * @brief Idle statistics since reset
+ */
+const idle_stats_t* idle_stats(void) {
+    return &stats;
+}
@@ -0,0 +1,181 @@
+/**
+ * Idle Governor - Sleep, Deep-Sleep and Stop Selection
+ *
+ * Purpose: Sleep as deeply as the time to the next scheduled event allows
+ * Features: Predicts the idle time from the software timer wheel and the
+ *           TMR14 tick, picks the deepest mode whose measured wakeup
+ *           latency fits, wakes from the ERTC wakeup timer, restores the
+ *           PLL and carries the stopped timers forward
+ * Performance: Plain sleep costs one compare over dispatch_wait(). A deep
+ *              mode adds ERTC programming on entry and the PLL lock on
+ *              exit (measured, reported as latency).
+ * Usage: Call idle_init() after the timers are running, then sleep through
+ *        the governor instead of calling dispatch_wait() directly
+ *
+ *   idle_init();
+ *   while (1) {
+ *       idle_sleep();
+ *       dispatch_run();
+ *       ...
+ *   }
+ *
+ * Modes (AT32F421 naming in brackets):
+ *   • Sleep:      __WFE() with every clock running
+ *   • Deep-sleep: [Deepsleep, LDO normal] - HICK, PLL and all bus clocks
+ *                 stop; the fastest deep mode to leave
+ *   • Stop:       [Deepsleep, LDO low-power] - as above with the regulator
+ *                 in low-power mode; lowest retained-SRAM current, slower
+ *                 to leave
+ *
+ * Wakeup and Timekeeping:
+ *   The ERTC runs from LICK (or LEXT) in both deep modes. Its wakeup timer
+ *   raises EXINT line 20 as an event, which ends __WFE(). The ERTC
+ *   sub-second counter runs without a prescaler, so the time actually
+ *   spent - sleep plus wakeup latency - is read back on every wake. LICK
+ *   is calibrated against TMR6 by idle_init(). TMR3, TMR6 and TMR14 stop
+ *   in the deep modes and are moved forward by that amount afterwards.
+ *
+ * Configuration Options:
+ *   • IDLE_DEEP_MODES: 1 = allow deep-sleep and stop, 0 = sleep only (default)
+ *   • IDLE_ERTC_LEXT: 1 = ERTC from a 32.768kHz crystal, 0 = LICK (default)
+ *   • IDLE_DEEPSLEEP_MIN_US / IDLE_STOP_MIN_US: shortest idle for each mode
+ *   • IDLE_LATENCY_MARGIN: the idle time must also exceed this many times
+ *     the mode's measured latency
+ *
+ * Note: The deep modes are opt-in because every clock stops: the PWM output
+ *       holds its level, and USART1 neither sends nor receives (bytes that
+ *       arrive are lost). Deep modes are skipped while output is pending
+ *       and until a staged boot (CRM_STAGED_BOOT) has reached the PLL.
+ */
+
+#ifndef IDLE_H
+#define IDLE_H
+
+#include "at32f421.h"
+
+#ifndef IDLE_DEEP_MODES
+  #define IDLE_DEEP_MODES             0
+#endif
+
+#ifndef IDLE_ERTC_LEXT
+  #define IDLE_ERTC_LEXT              0
+#endif
+
+/* Shortest predicted idle time for each deep mode */
+#ifndef IDLE_DEEPSLEEP_MIN_US
+  #define IDLE_DEEPSLEEP_MIN_US       2000U
+#endif
+#ifndef IDLE_STOP_MIN_US
+  #define IDLE_STOP_MIN_US            50000U
+#endif
+
+/* The idle time must also exceed this multiple of the measured latency */
+#define IDLE_LATENCY_MARGIN         4U
+
+/* Extra time reserved before the next event on top of the latency */
+#define IDLE_WAKE_GUARD_US          200U
+
+/* LICK calibration window and clock start-up limits */
+#define IDLE_ERTC_CAL_US            100000U
+#define IDLE_LOW_CLOCK_TIMEOUT      2000000U
+
+/* ERTC wakeup interrupt - EXINT line 20, used as an event only */
+#define IDLE_EXINT_LINE             (1U << 20)
+
+/*******************************************************************************
+ * PWC / ERTC Register Bit Definitions
+ ******************************************************************************/
+
+/* PWC CTRL */
+#define PWC_CTRL_VRSEL_Pos          0       /* LDO low-power in deepsleep */
+#define PWC_CTRL_VRSEL              (0x1U << PWC_CTRL_VRSEL_Pos)
+#define PWC_CTRL_LPSEL_Pos          1       /* Standby instead of deepsleep */
+#define PWC_CTRL_LPSEL              (0x1U << PWC_CTRL_LPSEL_Pos)
+#define PWC_CTRL_BPWEN_Pos          8       /* Battery domain write enable */
+#define PWC_CTRL_BPWEN              (0x1U << PWC_CTRL_BPWEN_Pos)
+
+/* ERTC CTRL */
+#define ERTC_CTRL_WATCLK_Pos        0
+#define ERTC_CTRL_WATCLK_Msk        (0x7U << ERTC_CTRL_WATCLK_Pos)
+#define ERTC_CTRL_WATCLK_DIV2       (0x3U << ERTC_CTRL_WATCLK_Pos)
+#define ERTC_CTRL_BPSH_Pos          5       /* Read counters directly */
+#define ERTC_CTRL_BPSH              (0x1U << ERTC_CTRL_BPSH_Pos)
+#define ERTC_CTRL_WATEN_Pos         10
+#define ERTC_CTRL_WATEN             (0x1U << ERTC_CTRL_WATEN_Pos)
+#define ERTC_CTRL_WATIEN_Pos        14
+#define ERTC_CTRL_WATIEN            (0x1U << ERTC_CTRL_WATIEN_Pos)
+
+/* ERTC STS */
+#define ERTC_STS_WATWF_Pos          2       /* Wakeup reload writable */
+#define ERTC_STS_WATWF              (0x1U << ERTC_STS_WATWF_Pos)
+#define ERTC_STS_IMF_Pos            6       /* Initialization mode entered */
+#define ERTC_STS_IMF                (0x1U << ERTC_STS_IMF_Pos)
+#define ERTC_STS_IMEN_Pos           7       /* Initialization mode request */
+#define ERTC_STS_IMEN               (0x1U << ERTC_STS_IMEN_Pos)
+#define ERTC_STS_WATF_Pos           10      /* Wakeup timer elapsed */
+#define ERTC_STS_WATF               (0x1U << ERTC_STS_WATF_Pos)
+
+/* ERTC DIV - sub-second counter at the full ERTC clock */
+#define ERTC_DIV_DIVB_Pos           0
+#define ERTC_DIV_DIVA_Pos           16
+#define ERTC_DIV_DIVB_SUBSECOND     0x7FFFU
+#define ERTC_SBS_MASK               ERTC_DIV_DIVB_SUBSECOND
+
+/* ERTC write protection keys */
+#define ERTC_WP_KEY1                0xCAU
+#define ERTC_WP_KEY2                0x53U
+#define ERTC_WP_LOCK                0xFFU
+
+/* Wakeup timer clock = ERTC clock / 2 */
+#define IDLE_WAT_DIV                2U
+
+/**
+ * @brief Idle modes, lightest first
+ */
+typedef enum {
+    IDLE_MODE_SLEEP = 0,            /*!< __WFE(), clocks running */
+    IDLE_MODE_DEEPSLEEP,            /*!< Deepsleep, LDO normal */
+    IDLE_MODE_STOP,                 /*!< Deepsleep, LDO low-power */
+    IDLE_MODE_COUNT
+} idle_mode_t;
+
+/**
+ * @brief Idle governor result codes
+ */
+typedef enum {
+    IDLE_OK = 0,                    /*!< Deep modes available (or not configured) */
+    IDLE_ERR_CLOCK                  /*!< ERTC clock did not start - sleep only */
+} idle_status_t;
+
+/**
+ * @brief Idle statistics since reset
+ */
+typedef struct {
+    uint32_t entries[IDLE_MODE_COUNT];      /*!< Sleeps per mode */
+    uint32_t latency_us[IDLE_MODE_COUNT];   /*!< Smoothed wakeup latency (sleep: 0) */
+    uint32_t latency_max_us[IDLE_MODE_COUNT]; /*!< Worst wakeup latency */
+    uint32_t early_wakes;                   /*!< Deep sleeps ended before the ERTC timer */
+    uint32_t restore_failures;              /*!< Clock restores that failed after a deep mode */
+    uint32_t ertc_hz;                       /*!< Calibrated ERTC clock (0 = no deep modes) */
+} idle_stats_t;
+
+/**
+ * @brief Start the ERTC wakeup path and calibrate its clock
+ * @note Needs time_init(); returns at once with IDLE_DEEP_MODES=0
+ * @return IDLE_OK, or IDLE_ERR_CLOCK if LICK/LEXT did not start
+ */
+idle_status_t idle_init(void);
+
+/**
+ * @brief Sleep until the next wakeup, as deeply as the next event allows
+ *
+ * Drop-in replacement for dispatch_wait().
+ */
+void idle_sleep(void);
+
+/**
+ * @brief Idle statistics since reset
+ */
+const idle_stats_t* idle_stats(void);
+
+#endif /* IDLE_H */
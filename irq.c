@@ -0,0 +1,86 @@
+/**
+ * Interrupt Vector Table in SRAM Implementation
+ */
+
+#include <stddef.h>
+#include "irq.h"
+
+/* Index of a line in the vector table - system exceptions are negative */
+#define IRQ_INDEX(irqn)             ((int32_t)(irqn) + 16)
+
+/* Entries 0 and 1 hold the initial stack pointer and the reset vector */
+#define IRQ_INDEX_FIRST_HANDLER     2
+
+#if IRQ_RAM_VECTORS
+static irq_handler_t irq_vectors[IRQ_VECTOR_COUNT] __attribute__((aligned(IRQ_VECTOR_ALIGN)));
+#endif
+
+/**
+ * @brief Copy the active vector table to SRAM and switch VTOR to it
+ */
+void irq_init(void) {
+#if IRQ_RAM_VECTORS
+    const irq_handler_t* active = (const irq_handler_t*)SCB->VTOR;
+    uint32_t primask = __get_PRIMASK();
+
+    if (active == irq_vectors) {
+        return;
+    }
+
+    __disable_irq();
+    for (uint32_t i = 0; i < IRQ_VECTOR_COUNT; i++) {
+        irq_vectors[i] = active[i];
+    }
+
+    /* The table must be complete before the core fetches from it */
+    __DSB();
+    SCB->VTOR = (uint32_t)irq_vectors;
+    __DSB();
+    __ISB();
+    __set_PRIMASK(primask);
+#endif
+}
+
+/**
+ * @brief Install the handler for an interrupt line or system exception
+ */
+irq_status_t irq_set_handler(IRQn_Type irqn, irq_handler_t handler) {
+    int32_t index = IRQ_INDEX(irqn);
+
+    if ((index < IRQ_INDEX_FIRST_HANDLER) || (index >= (int32_t)IRQ_VECTOR_COUNT) ||
+        (handler == NULL)) {
+        return IRQ_ERR_RANGE;
+    }
+    if (!irq_vectors_in_ram()) {
+        return IRQ_ERR_FLASH;
+    }
+
+#if IRQ_RAM_VECTORS
+    irq_vectors[index] = handler;
+    __DSB();
+#endif
+    return IRQ_OK;
+}
+
+/**
+ * @brief Handler the active table holds for an interrupt line
+ */
+irq_handler_t irq_get_handler(IRQn_Type irqn) {
+    int32_t index = IRQ_INDEX(irqn);
+
+    if ((index < IRQ_INDEX_FIRST_HANDLER) || (index >= (int32_t)IRQ_VECTOR_COUNT)) {
+        return NULL;
+    }
+    return ((const irq_handler_t*)SCB->VTOR)[index];
+}
+
+/**
+ * @brief Non-zero once VTOR points to the SRAM table
+ */
+uint32_t irq_vectors_in_ram(void) {
+#if IRQ_RAM_VECTORS
+    return SCB->VTOR == (uint32_t)irq_vectors;
+#else
+    return 0;
+#endif
+}
@@ -0,0 +1,92 @@
+/**
+ * Interrupt Vector Table in SRAM
+ *
+ * Purpose: Let drivers install interrupt handlers at run time instead of
+ *          relying on the fixed handler names of the startup's flash table
+ * Features: irq_init() copies the active vector table into an aligned SRAM
+ *           table and points VTOR at it; irq_set_handler() then replaces
+ *           any entry, system exceptions included
+ * Performance: On exception entry the core stacks registers over the
+ *              system bus while it fetches the vector. From flash that fetch
+ *              waits out the flash latency (3 wait states at 120MHz); from
+ *              SRAM it completes in a single cycle, so the handler starts
+ *              earlier. Combine with RAMFUNC (ramfunc.h) for the handler body.
+ * Usage: Call irq_init() first at boot, then hook lines as needed
+ *
+ *   irq_init();
+ *   irq_set_handler(TMR15_GLOBAL_IRQn, my_tmr15_isr);
+ *   NVIC_EnableIRQ(TMR15_GLOBAL_IRQn);
+ *
+ * Configuration Options:
+ *   • IRQ_RAM_VECTORS: 1 = table in SRAM (pass RAM_VECTORS=1 to make),
+ *                      0 = keep the flash table (default); irq_set_handler()
+ *                      then reports IRQ_ERR_FLASH
+ *   • IRQ_EXTERNAL_COUNT: Device interrupt lines covered by the table
+ *
+ * Note: Handlers linked under the startup's names (USART1_IRQHandler, ...)
+ *       keep working - they are copied along with the rest of the table.
+ */
+
+#ifndef IRQ_H
+#define IRQ_H
+
+#include "at32f421.h"
+
+#ifndef IRQ_RAM_VECTORS
+  #define IRQ_RAM_VECTORS             0
+#endif
+
+/* Device interrupt lines; 16 system exceptions come first */
+#ifndef IRQ_EXTERNAL_COUNT
+  #define IRQ_EXTERNAL_COUNT          48U
+#endif
+#define IRQ_VECTOR_COUNT            (16U + IRQ_EXTERNAL_COUNT)
+
+/* VTOR needs the table aligned to its size rounded up to a power of two */
+#define IRQ_VECTOR_ALIGN            256U
+
+#if (IRQ_VECTOR_COUNT * 4U) > IRQ_VECTOR_ALIGN
+  #error "IRQ_EXTERNAL_COUNT too large for IRQ_VECTOR_ALIGN"
+#endif
+
+/**
+ * @brief Interrupt or exception handler
+ */
+typedef void (*irq_handler_t)(void);
+
+/**
+ * @brief Vector table operation result codes
+ */
+typedef enum {
+    IRQ_OK = 0,                     /*!< Handler installed */
+    IRQ_ERR_RANGE,                  /*!< IRQn not in the table, or the stack pointer/reset entry */
+    IRQ_ERR_FLASH                   /*!< Table still in flash (IRQ_RAM_VECTORS=0) */
+} irq_status_t;
+
+/**
+ * @brief Copy the active vector table to SRAM and switch VTOR to it
+ * @note Does nothing with IRQ_RAM_VECTORS=0. Call before any interrupt is
+ *       enabled; later calls have no effect.
+ */
+void irq_init(void);
+
+/**
+ * @brief Install the handler for an interrupt line or system exception
+ * @param irqn    Device line (>= 0) or system exception (NonMaskableInt_IRQn ...)
+ * @param handler Function to run; takes effect with the next exception entry
+ * @return IRQ_OK or the reason for rejection
+ */
+irq_status_t irq_set_handler(IRQn_Type irqn, irq_handler_t handler);
+
+/**
+ * @brief Handler the active table holds for an interrupt line
+ * @return NULL if irqn is outside the table
+ */
+irq_handler_t irq_get_handler(IRQn_Type irqn);
+
+/**
+ * @brief Non-zero once VTOR points to the SRAM table
+ */
+uint32_t irq_vectors_in_ram(void);
+
+#endif /* IRQ_H */
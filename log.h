@@ -0,0 +1,106 @@
+/**
+ * Leveled, Per-Module Logging
+ *
+ * Purpose: Compile-time log filtering on top of TLOG()
+ * Features: Five levels, one threshold per module, one line per record
+ * Performance: Records below the module threshold are removed by the
+ *              preprocessor - no code, no string literal, no token
+ * Usage: Define LOG_MODULE_NAME and LOG_MODULE_LEVEL, then include log.h
+ *
+ *   #define LOG_MODULE_NAME   "main"
+ *   #define LOG_MODULE_LEVEL  LOG_LEVEL_MAIN
+ *   #include "log.h"
+ *
+ *   LOG_INFO("SYSCLK: %uMHz", SYSTEM_CLOCK_HZ / 1000000);
+ *
+ * Record Layout:
+ *   "<L> <module>: <message>\r\n", where L is one of E W I D T. The prefix
+ *   and line ending are concatenated with the format string at compile time,
+ *   so they cost nothing at run time in tokenized mode (see tlog.h).
+ *
+ * Configuration Options:
+ *   • LOG_LEVEL_DEFAULT: Threshold for every module (default: LOG_LEVEL_DEBUG)
+ *                        - `make LOG_LEVEL=1` keeps errors only
+ *   • LOG_LEVEL_MAIN / _CRM / _TIMER / _USART: Per-module overrides
+ *
+ * Note: Each translation unit includes log.h once, after choosing its
+ *       module name and level. crm.c, timer.c and usart.c log from thread
+ *       context only - never from the transmit path or before
+ *       usart_config().
+ */
+
+#ifndef LOG_H
+#define LOG_H
+
+#include "tlog.h"
+
+/* Log levels - a record is kept when its level <= the module threshold */
+#define LOG_LEVEL_NONE              0
+#define LOG_LEVEL_ERROR             1
+#define LOG_LEVEL_WARN              2
+#define LOG_LEVEL_INFO              3
+#define LOG_LEVEL_DEBUG             4
+#define LOG_LEVEL_TRACE             5
+
+#ifndef LOG_LEVEL_DEFAULT
+  #define LOG_LEVEL_DEFAULT           LOG_LEVEL_DEBUG
+#endif
+
+/* Per-module thresholds */
+#ifndef LOG_LEVEL_MAIN
+  #define LOG_LEVEL_MAIN              LOG_LEVEL_DEFAULT
+#endif
+
+#ifndef LOG_LEVEL_CRM
+  #define LOG_LEVEL_CRM               LOG_LEVEL_DEFAULT
+#endif
+
+#ifndef LOG_LEVEL_TIMER
+  #define LOG_LEVEL_TIMER             LOG_LEVEL_DEFAULT
+#endif
+
+#ifndef LOG_LEVEL_USART
+  #define LOG_LEVEL_USART             LOG_LEVEL_DEFAULT
+#endif
+
+#if !defined(LOG_MODULE_NAME) || !defined(LOG_MODULE_LEVEL)
+  #error "Define LOG_MODULE_NAME and LOG_MODULE_LEVEL before including log.h"
+#endif
+
+/* Build one record: compile-time prefix + format + line ending */
+#define LOG_RECORD_(tag, fmt, ...)  TLOG(tag " " LOG_MODULE_NAME ": " fmt "\r\n", ##__VA_ARGS__)
+
+#if LOG_MODULE_LEVEL >= LOG_LEVEL_ERROR
+  #define LOG_ERROR(fmt, ...)         LOG_RECORD_("E", fmt, ##__VA_ARGS__)
+#else
+  #define LOG_ERROR(fmt, ...)         do { } while (0)
+#endif
+
+#if LOG_MODULE_LEVEL >= LOG_LEVEL_WARN
+  #define LOG_WARN(fmt, ...)          LOG_RECORD_("W", fmt, ##__VA_ARGS__)
+#else
+  #define LOG_WARN(fmt, ...)          do { } while (0)
+#endif
+
+#if LOG_MODULE_LEVEL >= LOG_LEVEL_INFO
+  #define LOG_INFO(fmt, ...)          LOG_RECORD_("I", fmt, ##__VA_ARGS__)
+#else
+  #define LOG_INFO(fmt, ...)          do { } while (0)
+#endif
+
+#if LOG_MODULE_LEVEL >= LOG_LEVEL_DEBUG
+  #define LOG_DEBUG(fmt, ...)         LOG_RECORD_("D", fmt, ##__VA_ARGS__)
+#else
+  #define LOG_DEBUG(fmt, ...)         do { } while (0)
+#endif
+
+#if LOG_MODULE_LEVEL >= LOG_LEVEL_TRACE
+  #define LOG_TRACE(fmt, ...)         LOG_RECORD_("T", fmt, ##__VA_ARGS__)
+#else
+  #define LOG_TRACE(fmt, ...)         do { } while (0)
+#endif
+
+/* Guard for code that only exists to feed a log statement */
+#define LOG_ENABLED(level)          (LOG_MODULE_LEVEL >= (level))
+
+#endif /* LOG_H */
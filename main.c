@@ -7,23 +7,42 @@
  *
  * Key Architectural Features:
  *   - System Initialization: A single `system_init()` orchestrates all hardware setup.
- *   - Event-Driven Loop: The main `while(1)` loop is driven by timer events.
+ *   - Event-Driven Loop: The main `while(1)` loop is driven by registered wakeup
+ *     sources (dispatch.h) and by events queued from interrupt handlers (event.h).
  *   - Low-Power Sleep: `__WFE()` (Wait For Event) is used to put the core to sleep.
  *   - Interrupt-less Wake-up: `SEVONPEND` allows timer flags to wake the core
  *     without needing a full interrupt service routine (ISR).
  *   - Race-Condition Handling: The code is structured to handle race conditions
  *     where events occur during initialization, using the `__SEV()` + `__WFE()` idiom.
+ *   - Staged Boot (`make STAGED_BOOT=1`): drivers and the banner come up on HICK;
+ *     the PLL stable flag is one more wakeup source and switches the clock.
+ *     Boot milestones are logged either way.
  */
 
 #include "at32f421.h"
+#include "cpuload.h"
 #include "crm.h"
+#include "dispatch.h"
+#include "event.h"
 #include "gpio.h" 
+#include "idle.h"
+#include "irq.h"
+#include "prof.h"
+#include "sched.h"
+#include "startup.h"
+#include "swtimer.h"
+#include "systime.h"
 #include "timer.h"
+#include "trim.h"
 #include "usart.h"
 
-#define DEBUG_ENABLED 1
+/* Log output: text by default, binary tokens with `make TOKENIZED=1`.
+ * Verbosity: LOG_LEVEL_MAIN (or `make LOG_LEVEL=n` for every module). */
+#define LOG_MODULE_NAME  "main"
+#define LOG_MODULE_LEVEL LOG_LEVEL_MAIN
+#include "log.h"
 
-/* The IRQn for TMR14 is needed for clearing the NVIC pending bit.
+/* The IRQn for TMR14 is needed to register it as a wakeup source.
  * This value should be verified in the device's official startup file. */
 #ifndef TMR14_GLOBAL_IRQn
   #define TMR14_GLOBAL_IRQn  19
@@ -32,11 +51,73 @@
 /* Private function prototypes */
 static void system_init(void);
 static void print_system_info(void);
-static void print_runtime_stats(void);
+static void print_runtime_stats(uint32_t events);
+static void process_rx_frames(uint32_t events);
+static uint32_t tmr14_overflow_check(void);
+static void on_timer_tick(void);
+static void on_rx_frame(const event_t* event);
+static uint32_t frame_has_prefix(const uint8_t* frame, uint32_t len, const char* word);
+static uint32_t frame_parse_u32(const uint8_t* arg, uint32_t len);
+static void command_baud(const uint8_t* arg, uint32_t len);
+static void command_clock(const uint8_t* arg, uint32_t len);
+static void command_clocks(void);
+static void command_trim(const uint8_t* arg, uint32_t len);
+static void trim_finish(void);
+static void process_autobaud(void);
+static void print_boot_times(void);
+static void on_clock_event(void);
+#if CRM_STAGED_BOOT
+static void on_boot_timeout(swtimer_t* timer);
+#endif
+
+/* Scheduler event bits used by the application tasks. */
+#define APP_EVENT_RX_FRAME          (1U << 0)
+
+/* Statistics are printed every STATS_PERIOD_TICKS TMR14 overflows. */
+#define STATS_PERIOD_TICKS          5U
+
+/* Application tasks: run-to-completion, no stacks of their own. */
+static const sched_task_t rx_task = {
+    .fn = process_rx_frames, .priority = 1, .period = 0, .event_mask = APP_EVENT_RX_FRAME
+};
+
+static const sched_task_t stats_task = {
+    .fn = print_runtime_stats, .priority = 2, .period = STATS_PERIOD_TICKS, .event_mask = 0
+};
 
 /* Global counters for runtime statistics. */
 static uint32_t timer_overflow_count = 0;
-static uint32_t wfe_wake_count = 0;
+
+/* Boot milestones, in microseconds since reset (Reset_Handler() entry). */
+typedef enum {
+    BOOT_MAIN = 0,                  /* .data/.bss ready, main() called */
+    BOOT_CLOCK,                     /* crm_config() done / crm_boot_start() returned */
+    BOOT_OUTPUT,                    /* Banner queued for transmission */
+    BOOT_READY,                     /* system_init() done, entering the main loop */
+    BOOT_PLL,                       /* Running at SYSTEM_CLOCK_HZ */
+    BOOT_MILESTONES
+} boot_milestone_t;
+
+static uint32_t boot_us[BOOT_MILESTONES];
+static uint32_t boot_base_us = 0;
+
+/* Outcome of the blocking clock setup, reported once USART1 is up. */
+static crm_status_t clock_status = CRM_OK;
+
+/* Host baud rate of a pending "trim" measurement, 0 if none. */
+static uint32_t trim_baud = 0;
+
+#if CRM_STAGED_BOOT
+/* Gives up on HEXT/PLL after CRM_BOOT_TIMEOUT_MS and stays on HICK. */
+static swtimer_t boot_timer;
+#endif
+
+/**
+ * @brief  Records a boot milestone on the microsecond clock.
+ */
+static void boot_mark(boot_milestone_t milestone) {
+    boot_us[milestone] = boot_base_us + (uint32_t)time_now_us();
+}
 
 /**
  * @brief  Main application entry point.
@@ -44,31 +125,40 @@ static uint32_t wfe_wake_count = 0;
 int main(void) {
 
     system_init();
-    print_system_info();
+#if !CRM_STAGED_BOOT
+    print_boot_times();
+#endif
     
     while (1) {
         /*
-         * 1. Clear the NVIC pending bit for the TMR14 interrupt. This is required
-         *    to allow the next interrupt to trigger a wake-up event, as SEVONPEND
-         *    only generates an event on a 0-to-1 transition of the pending bit.
-         */
-        NVIC_ClearPendingIRQ(TMR14_GLOBAL_IRQn);
-        
-        /*
-         * 2. Execute Wait For Event. The ARM core's internal event latch ensures
-         *    that no events are missed if they occur between the clear above
-         *    and this instruction.
+         * 1. Clear the NVIC pending bits of all registered wakeup sources and
+         *    execute Wait For Event. SEVONPEND only generates an event on a
+         *    0-to-1 transition of a pending bit; the core's event latch ensures
+         *    that nothing is missed between the clear and the WFE. The idle
+         *    governor picks the sleep depth from the time to the next timer
+         *    event. The duty-cycle accounting brackets the time spent asleep.
          */
-        __WFE();
-        
-        wfe_wake_count++;
+        cpuload_sleep_enter();
+        idle_sleep();
+        cpuload_sleep_exit();
+        PROF_BEGIN(main_loop);
         
-        /* 3. Check the peripheral's flag to confirm the source of the wake-up. */
-        if (TMR14->ists & TMR_ISTS_OVFIF) {
-            TMR14->ists &= ~TMR_ISTS_OVFIF;
-            timer_overflow_count++;
-            print_runtime_stats();
-        }
+        /* 2. Run the sources whose pending bit and flag confirm the wake-up. */
+        PROF_BEGIN(dispatch_run);
+        dispatch_run();
+        PROF_END(dispatch_run);
+
+        /* 3. Service everything the interrupt handlers queued in one batch. */
+        PROF_BEGIN(event_dispatch);
+        event_dispatch();
+        PROF_END(event_dispatch);
+
+        /* 4. Run the tasks released by the above; sleep again once none is ready. */
+        PROF_BEGIN(sched_run);
+        sched_run();
+        PROF_END(sched_run);
+
+        PROF_END(main_loop);
     }
 
     return 0;
@@ -78,10 +168,69 @@ int main(void) {
  * @brief  Initializes all system hardware and clears any spurious startup events.
  */
 static void system_init(void) {
-    crm_config();
+    /* Vector table to SRAM before any interrupt is enabled (RAM_VECTORS=1) */
+    irq_init();
+    prof_init();
+
+    /* Stored HICK trim first: the PLL multiplies whatever HICK delivers */
+    (void)trim_init();
+
+#if CRM_STAGED_BOOT
+    crm_boot_start();
+#else
+    PROF_BEGIN(crm_config);
+    clock_status = crm_config();
+    PROF_END(crm_config);
+#endif
+
+    /* The cycle counter has run on HICK so far, restarted by prof_init()
+     * after the startup code; the microsecond clock takes over from here
+     * (crm_config() spends nearly all its time on HICK, so its few PLL
+     * cycles are overcounted by well under 1us). */
+    boot_us[BOOT_MAIN] = startup_main_cycles() / (CRM_HICK_HZ / 1000000U);
+    boot_base_us = (startup_main_cycles() + DWT->CYCCNT) / (CRM_HICK_HZ / 1000000U);
+    time_init();
+    boot_mark(BOOT_CLOCK);
+#if !CRM_STAGED_BOOT
+    boot_us[BOOT_PLL] = boot_us[BOOT_CLOCK];
+#endif
+
+    /* Output first: the banner goes out while the rest starts */
     gpio_config();
-    timer_config();
     usart_config();
+    print_system_info();
+    boot_mark(BOOT_OUTPUT);
+    if (clock_status != CRM_OK) {
+        LOG_ERROR("Clock setup failed (%u), SYSCLK %uMHz", (uint32_t)clock_status,
+                  crm_get_clocks()->sclk_hz / 1000000U);
+    }
+
+    timer_config();
+    swtimer_init();
+
+    /* Deep-sleep wakeup path (only with IDLE_DEEP_MODES=1) */
+    if (idle_init() != IDLE_OK) {
+        LOG_WARN("ERTC clock failed, deep sleep disabled");
+    }
+
+    /* Interrupt-less wakeup sources, highest priority first */
+    dispatch_register(0, TMR1_CH_IRQn, NULL, process_autobaud);
+    dispatch_register(1, TMR14_GLOBAL_IRQn, tmr14_overflow_check, on_timer_tick);
+    dispatch_register(2, SWTIMER_IRQn, swtimer_check, swtimer_process);
+    dispatch_register(3, CRM_IRQn, crm_event_check, on_clock_event);
+#if CRM_STAGED_BOOT
+    swtimer_start(&boot_timer, CRM_BOOT_TIMEOUT_MS, 0, on_boot_timeout);
+#endif
+
+    /* Events posted by interrupt handlers */
+    event_register(EVENT_RX_FRAME, on_rx_frame);
+
+    /* Duty-cycle accounting, first window starts here */
+    cpuload_init();
+
+    /* Tasks, released by TMR14 ticks and by events */
+    sched_add(&rx_task, 0);
+    sched_add(&stats_task, STATS_PERIOD_TICKS);
     
     /* Enable SEVONPEND to allow pending interrupts to generate __WFE() events. */
     SCB->SCR |= SCB_SCR_SEVONPEND_Msk;
@@ -95,58 +244,330 @@ static void system_init(void) {
      */
     __SEV();
     __WFE();
+    boot_mark(BOOT_READY);
 }
 
 /**
  * @brief  Prints a startup banner with key system parameters.
  */
 static void print_system_info(void) {
-#if DEBUG_ENABLED
-    usart_puts("\r\nAT32F421 PWM Demo with WFE\r\n");
-    usart_puts("---------------------------\r\n");
-    usart_puts("SYSCLK: ");
-    usart_put_uint(SYSTEM_CLOCK_HZ / 1000000);
-    usart_puts("MHz, PWM Freq: ");
-    usart_put_uint(PWM_FREQUENCY_HZ);
-    usart_puts("Hz, Duty: ");
-    usart_put_uint(PWM_DUTY_RATIO);
-    usart_puts("%\r\n");
-    usart_puts("Power Mode: SEVONPEND + WFE Enabled\r\n\r\n");
-#endif
+    LOG_INFO("AT32F421 PWM Demo with WFE");
+    LOG_INFO("SYSCLK: %uMHz, PWM Freq: %uHz, Duty: %u%%",
+             crm_get_clocks()->sclk_hz / 1000000U, PWM_FREQUENCY_HZ, PWM_DUTY_RATIO);
+    LOG_INFO("Power Mode: SEVONPEND + WFE Enabled");
 }
 
 /**
- * @brief  Prints runtime statistics periodically.
+ * @brief  Logs the boot milestones once the system clock is final.
  */
-static void print_runtime_stats(void) {
-#if DEBUG_ENABLED
-    static uint32_t last_print_time = 0;
-    uint32_t current_time = timer_overflow_count;
-    
-    if ((current_time - last_print_time) >= 5) {
-        usart_puts("TMR Events: ");
-        usart_put_uint(timer_overflow_count);
-        usart_puts(", WFE Wakes: ");
-        usart_put_uint(wfe_wake_count);
-        
-        if (wfe_wake_count > 0) {
-            uint32_t efficiency = (timer_overflow_count * 100) / wfe_wake_count;
-            usart_puts(", Efficiency: ");
-            usart_put_uint(efficiency);
-            usart_puts("%");
+static void print_boot_times(void) {
+    LOG_INFO("Boot: main %uus, clock %uus, output %uus, ready %uus, PLL %uus",
+             boot_us[BOOT_MAIN], boot_us[BOOT_CLOCK], boot_us[BOOT_OUTPUT],
+             boot_us[BOOT_READY], boot_us[BOOT_PLL]);
+}
+
+/**
+ * @brief  CRM line handler: staged boot progress and HEXT failover.
+ */
+static void on_clock_event(void) {
+#if CRM_STAGED_BOOT
+    if (crm_boot_pending()) {
+        crm_status_t status = crm_boot_poll();
+
+        /* The outcome itself is logged by crm.c */
+        if (status != CRM_BUSY) {
+            swtimer_stop(&boot_timer);
+            if (status == CRM_OK) {
+                boot_mark(BOOT_PLL);
+                print_boot_times();
+            }
         }
-        usart_puts("\r\n");
-        last_print_time = current_time;
     }
 #endif
+    (void)crm_failover_poll();
+}
+
+#if CRM_STAGED_BOOT
+
+/**
+ * @brief  Boot timer: HEXT or the PLL did not come up in CRM_BOOT_TIMEOUT_MS.
+ */
+static void on_boot_timeout(swtimer_t* timer) {
+    (void)timer;
+    (void)crm_boot_cancel();
+    print_boot_times();
+}
+#endif
+
+/**
+ * @brief  Task: prints runtime statistics every STATS_PERIOD_TICKS (DEBUG level).
+ */
+static void print_runtime_stats(uint32_t events) {
+    (void)events;
+#if LOG_ENABLED(LOG_LEVEL_DEBUG)
+    static uint32_t last_tx_wait = 0;
+    uint32_t tx_wait = usart_tx_wait_cycles();
+    cpuload_stats_t load;
+
+    cpuload_sample(&load);
+    LOG_DEBUG("Uptime: %ums", (uint32_t)(time_now_us() / 1000U));
+    LOG_DEBUG("CPU Load: %u.%u%%, Active: %uus, Sleep: %uus",
+              load.load_permille / 10U, load.load_permille % 10U,
+              load.active_us, load.sleep_us);
+    LOG_DEBUG("Wakes: %u, TMR Events: %u, Longest: %uus, TX Wait: %uus",
+              load.wakes, timer_overflow_count, load.max_active_us,
+              (tx_wait - last_tx_wait) / (crm_get_clocks()->ahb_hz / 1000000U));
+    LOG_DEBUG("Idle: sleep %u, deep %u (%u/%uus), stop %u (%u/%uus), early %u",
+              idle_stats()->entries[IDLE_MODE_SLEEP],
+              idle_stats()->entries[IDLE_MODE_DEEPSLEEP],
+              idle_stats()->latency_us[IDLE_MODE_DEEPSLEEP],
+              idle_stats()->latency_max_us[IDLE_MODE_DEEPSLEEP],
+              idle_stats()->entries[IDLE_MODE_STOP],
+              idle_stats()->latency_us[IDLE_MODE_STOP],
+              idle_stats()->latency_max_us[IDLE_MODE_STOP],
+              idle_stats()->early_wakes);
+    LOG_DEBUG("Active/Wake: <4us %u, <16us %u, <64us %u, <256us %u, "
+              "<1ms %u, <4ms %u, <16ms %u, more %u",
+              load.hist[0], load.hist[1], load.hist[2], load.hist[3],
+              load.hist[4], load.hist[5], load.hist[6], load.hist[7]);
+    last_tx_wait = tx_wait;
+    LOG_DEBUG("Events: %u, Dropped: %u, Max Batch: %u",
+              event_stats()->posted, event_stats()->dropped,
+              event_stats()->max_batch);
+    LOG_DEBUG("Clock: %uMHz, HEXT failures %u, timeouts %u, failover errors %u",
+              crm_get_clocks()->sclk_hz / 1000000U, crm_health()->clock_failures,
+              crm_health()->hext_timeouts, crm_health()->failover_errors);
+    LOG_DEBUG("Tasks: %u runs, %u deadline misses",
+              sched_stats()->runs, sched_stats()->deadline_misses);
+#if STARTUP_STACK_PAINT
+    LOG_DEBUG("Stack: %u bytes never used", startup_stack_unused());
+#endif
+    LOG_DEBUG("RX Frames: %u, Bytes: %u, Overruns: %u/%u/%u",
+              usart_rx_stats()->frames, usart_rx_stats()->bytes,
+              usart_rx_stats()->hw_overruns, usart_rx_stats()->ring_overruns,
+              usart_rx_stats()->frame_drops);
+#endif
+}
+
+/**
+ * @brief  Returns 1 if the received frame starts with the given word.
+ */
+static uint32_t frame_has_prefix(const uint8_t* frame, uint32_t len, const char* word) {
+    while (*word) {
+        if ((len == 0U) || (*frame++ != (uint8_t)*word++)) {
+            return 0;
+        }
+        len--;
+    }
+    return 1;
+}
+
+/**
+ * @brief  Returns the decimal number at the start of a command argument.
+ */
+static uint32_t frame_parse_u32(const uint8_t* arg, uint32_t len) {
+    uint32_t value = 0;
+
+    while (len && (*arg >= '0') && (*arg <= '9')) {
+        value = value * 10U + (uint32_t)(*arg++ - '0');
+        len--;
+    }
+    return value;
+}
+
+/**
+ * @brief  Handles "baud <rate>": switches USART1 after acknowledging at the old rate.
+ */
+static void command_baud(const uint8_t* arg, uint32_t len) {
+    uint32_t baud = frame_parse_u32(arg, len);
+    usart_status_t status;
+
+    LOG_INFO("Baud: %u -> %u", usart_get_baud(), baud);
+    status = usart_set_baud(baud);
+    if (status == USART_OK) {
+        LOG_INFO("Baud: %u, Error: %uppm", baud, usart_baud_error_ppm());
+    }
+}
+
+/**
+ * @brief  Handles "clock <MHz>": rescales the system clock; drivers follow via notifiers.
+ */
+static void command_clock(const uint8_t* arg, uint32_t len) {
+    uint32_t mhz = frame_parse_u32(arg, len);
+    crm_status_t status;
+
+    LOG_INFO("SYSCLK: %uMHz -> %uMHz", crm_get_clocks()->sclk_hz / 1000000U, mhz);
+    status = crm_set_sysclk(mhz * 1000000U);
+
+    /* A failed switch is logged by crm.c; only rejections are left here */
+    if ((status == CRM_BUSY) || (status == CRM_ERR_FREQUENCY)) {
+        LOG_WARN("SYSCLK %uMHz rejected (%u)", mhz, (uint32_t)status);
+    }
+}
+
+/**
+ * @brief  Handles "clocks": lists the peripheral clocks, their references and state.
+ */
+static void command_clocks(void) {
+    usart_puts("periph   refs  state\r\n");
+    for (uint32_t i = 0; i < CRM_PERIPH_COUNT; i++) {
+        char line[8U + 5U];
+        uint32_t n = 0;
+
+        for (const char* name = crm_periph_name((crm_periph_t)i); *name && (n < 8U); name++) {
+            line[n++] = *name;
+        }
+        while (n < 8U) {
+            line[n++] = ' ';
+        }
+        n += fmt_u32_pad(&line[n], crm_periph_refs((crm_periph_t)i), 5U, ' ');
+        usart_write(line, n);
+        usart_puts(crm_periph_enabled((crm_periph_t)i) ? "  on\r\n" : "  off\r\n");
+    }
+    usart_puts("ahben 0x");
+    usart_put_hex(CRM->ahben, 8U);
+    usart_puts(" apb1en 0x");
+    usart_put_hex(CRM->apb1en, 8U);
+    usart_puts(" apb2en 0x");
+    usart_put_hex(CRM->apb2en, 8U);
+    usart_puts("\r\n");
+}
+
+/**
+ * @brief  Handles "trim [baud]": measures HICK against a 'U' the host sends at baud.
+ */
+static void command_trim(const uint8_t* arg, uint32_t len) {
+    while (len && (*arg == ' ')) {
+        arg++;
+        len--;
+    }
+    trim_baud = frame_parse_u32(arg, len);
+    if (trim_baud == 0U) {
+        trim_baud = usart_get_baud();
+    }
+    LOG_INFO("Trim: send 'U' at %u", trim_baud);
+    usart_autobaud_start();
+}
+
+/**
+ * @brief  Handles "trim save": stores the current HICKTRIM in flash.
+ */
+static void command_trim_save(void) {
+    trim_status_t status = trim_save();
+
+    if (status != TRIM_OK) {
+        LOG_ERROR("Trim: HICKTRIM %u save failed (%u)", trim_get(), (uint32_t)status);
+    } else {
+        LOG_INFO("Trim: HICKTRIM %u saved", trim_get());
+    }
+}
+
+/**
+ * @brief  Corrects HICK from the autobaud result and returns to the host's rate.
+ *
+ * The autobaud rate is what the untrimmed clock made of the host's rate;
+ * the difference is the HICK error. Send "trim" again to refine, and
+ * "trim save" to keep the result.
+ */
+static void trim_finish(void) {
+    int32_t error_ppm = trim_error_ppm(trim_baud, usart_get_baud());
+    trim_status_t status = trim_adjust_ppm(error_ppm);
+
+    (void)usart_set_baud(trim_baud);
+    trim_baud = 0;
+    if (status != TRIM_OK) {
+        LOG_WARN("Trim: HICK %dppm, HICKTRIM at limit %u", error_ppm, trim_get());
+    } else {
+        LOG_INFO("Trim: HICK %dppm, HICKTRIM now %u", error_ppm, trim_get());
+    }
+}
+
+/**
+ * @brief  Confirms and acknowledges a TMR14 overflow.
+ */
+static uint32_t tmr14_overflow_check(void) {
+    if (TMR14->ists & TMR_ISTS_OVFIF) {
+        TMR14->ists &= ~TMR_ISTS_OVFIF;
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief  TMR14 overflow handler: periodic work at PWM_FREQUENCY_HZ.
+ */
+static void on_timer_tick(void) {
+    timer_overflow_count++;
+    sched_tick();
+}
+
+/**
+ * @brief  EVENT_RX_FRAME handler: one or more frames are waiting.
+ */
+static void on_rx_frame(const event_t* event) {
+    (void)event;
+    sched_signal(APP_EVENT_RX_FRAME);
+}
+
+/**
+ * @brief  Reports the outcome of an autobaud measurement.
+ */
+static void process_autobaud(void) {
+    switch (usart_autobaud_poll()) {
+    /* The result itself is logged by usart.c */
+    case USART_AUTOBAUD_DONE:
+        if (trim_baud != 0U) {
+            trim_finish();
+        }
+        break;
+    case USART_AUTOBAUD_FAILED:
+        trim_baud = 0;
+        break;
+    default:
+        break;
+    }
+}
+
+/**
+ * @brief  Task: drains the USART1 receive frame queue and runs recognised commands.
+ */
+static void process_rx_frames(uint32_t events) {
+    uint8_t frame[USART_RX_BUFFER_SIZE / 2U];
+    uint32_t len;
+
+    (void)events;
+    while ((len = usart_rx_frame(frame, sizeof(frame))) != 0U) {
+        if (frame_has_prefix(frame, len, "baud ")) {
+            command_baud(frame + 5, len - 5U);
+        } else if (frame_has_prefix(frame, len, "clock ")) {
+            command_clock(frame + 6, len - 6U);
+        } else if (frame_has_prefix(frame, len, "clocks")) {
+            command_clocks();
+        } else if (frame_has_prefix(frame, len, "trim save")) {
+            command_trim_save();
+        } else if (frame_has_prefix(frame, len, "trim")) {
+            command_trim(frame + 4, len - 4U);
+        } else if (frame_has_prefix(frame, len, "autobaud")) {
+            LOG_INFO("Autobaud: send 'U' at the new rate");
+            usart_autobaud_start();
+        } else if (frame_has_prefix(frame, len, "prof bench")) {
+            prof_bench();
+        } else if (frame_has_prefix(frame, len, "prof reset")) {
+            prof_reset();
+        } else if (frame_has_prefix(frame, len, "prof")) {
+            prof_dump();
+        } else {
+            LOG_DEBUG("RX Frame: %u bytes, first 0x%02X", len, frame[0]);
+        }
+    }
 }
 
 /**
  * @brief  Hard Fault Handler.
  */
 void HardFault_Handler(void) {
-#if DEBUG_ENABLED
-    usart_puts("\r\n*** HARD FAULT! ***\r\nSystem Halted.\r\n");
+#if LOG_ENABLED(LOG_LEVEL_ERROR)
+    usart_panic_puts("\r\n*** HARD FAULT! ***\r\nSystem Halted.\r\n");
 #endif
     while (1) {
         __NOP();
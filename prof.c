@@ -0,0 +1,253 @@
+/**
+ * DWT Cycle-Counter Profiling Probes Implementation
+ */
+
+#include "prof.h"
+#include "fmt.h"
+#include "usart.h"
+#include "ramfunc.h"
+
+#if PROFILING
+
+prof_probe_t prof_probes[PROF_PROBE_COUNT];
+
+static const char* const prof_names[PROF_PROBE_COUNT] = {
+#define PROF_NAME_ENTRY_(name)      #name,
+    PROF_PROBE_LIST(PROF_NAME_ENTRY_)
+#undef PROF_NAME_ENTRY_
+};
+
+/* Column layout of the dump */
+#define PROF_NAME_WIDTH             16U
+#define PROF_VALUE_WIDTH            11U
+
+#endif /* PROFILING */
+
+/* Flash-vs-SRAM benchmark: bitwise CRC-32 over a buffer, a short loop
+ * with a taken branch per bit - the worst case for the prefetch buffer */
+#define PROF_BENCH_BYTES            64U
+#define PROF_BENCH_RUNS             8U
+#define PROF_BENCH_POLY             0xEDB88320U
+
+/* Formatter benchmark: fmt_u32() against the div/mod loop that
+ * usart_put_uint() used before fmt.c, over 1- to 10-digit values */
+#define PROF_BENCH_VALUES           32U
+
+/**
+ * @brief Benchmark kernel body, instantiated once in flash and once in SRAM
+ */
+static inline __attribute__((always_inline))
+uint32_t prof_bench_crc(const uint8_t* data, uint32_t len) {
+    uint32_t crc = 0xFFFFFFFFU;
+
+    while (len--) {
+        crc ^= *data++;
+        for (uint32_t bit = 0; bit < 8U; bit++) {
+            crc = (crc & 1U) ? ((crc >> 1) ^ PROF_BENCH_POLY) : (crc >> 1);
+        }
+    }
+    return ~crc;
+}
+
+static __attribute__((noinline)) uint32_t prof_bench_flash(const uint8_t* data, uint32_t len) {
+    return prof_bench_crc(data, len);
+}
+
+RAMFUNC static uint32_t prof_bench_sram(const uint8_t* data, uint32_t len) {
+    return prof_bench_crc(data, len);
+}
+
+/**
+ * @brief Reference formatter - the pre-fmt.c usart_put_uint() digit loop
+ *
+ * Builds the number backwards with % 10 and / 10 (UDIV at -Os), then
+ * copies it out, as the old code did through usart_puts(). Placed like
+ * fmt_u32() so that both run from the same memory.
+ */
+RAMFUNC static uint32_t prof_bench_divmod(char* dst, uint32_t value) {
+    char buffer[FMT_U32_MAX];
+    char* ptr = buffer + sizeof(buffer);
+    uint32_t n = 0;
+
+    do {
+        *(--ptr) = (char)('0' + (value % 10U));
+        value /= 10U;
+    } while (value);
+
+    while (ptr < buffer + sizeof(buffer)) {
+        dst[n++] = *ptr++;
+    }
+    return n;
+}
+
+/**
+ * @brief Cycles for PROF_BENCH_RUNS passes of one kernel, interrupts masked
+ */
+static uint32_t prof_bench_time(uint32_t (*kernel)(const uint8_t*, uint32_t),
+                                const uint8_t* data, uint32_t* crc) {
+    uint32_t primask = __get_PRIMASK();
+    uint32_t start, cycles;
+
+    __disable_irq();
+    start = DWT->CYCCNT;
+    for (uint32_t run = 0; run < PROF_BENCH_RUNS; run++) {
+        *crc = kernel(data, PROF_BENCH_BYTES);
+    }
+    cycles = DWT->CYCCNT - start;
+    __set_PRIMASK(primask);
+    return cycles;
+}
+
+/**
+ * @brief Cycles for PROF_BENCH_RUNS passes of one formatter over all
+ *        values, interrupts masked
+ * @param length Receives the total output length of the last pass
+ */
+static uint32_t prof_bench_fmt_time(uint32_t (*format)(char*, uint32_t),
+                                    const uint32_t* values, uint32_t* length) {
+    uint32_t primask = __get_PRIMASK();
+    char text[FMT_U32_MAX];
+    uint32_t start, cycles;
+
+    __disable_irq();
+    start = DWT->CYCCNT;
+    for (uint32_t run = 0; run < PROF_BENCH_RUNS; run++) {
+        *length = 0;
+        for (uint32_t i = 0; i < PROF_BENCH_VALUES; i++) {
+            *length += format(text, values[i]);
+        }
+    }
+    cycles = DWT->CYCCNT - start;
+    __set_PRIMASK(primask);
+    return cycles;
+}
+
+/**
+ * @brief Print "bench <label> cycles: a / b (ratio x)" and whether the
+ *        two variants agreed
+ */
+static void prof_bench_report(const char* label, uint32_t a, uint32_t b, uint32_t same) {
+    char line[64];
+    uint32_t n = 0;
+
+    usart_puts("bench ");
+    usart_puts(label);
+    usart_puts(" cycles: ");
+
+    n += fmt_u32(&line[n], a);
+    line[n++] = ' ';
+    line[n++] = '/';
+    line[n++] = ' ';
+    n += fmt_u32(&line[n], b);
+
+    /* Speedup of b over a as a Q16 ratio, printed with two decimals */
+    line[n++] = ' ';
+    line[n++] = '(';
+    n += fmt_q(&line[n], (int32_t)(((uint64_t)a << 16) / (b ? b : 1U)), 16U, 2U);
+    line[n++] = 'x';
+    line[n++] = ')';
+    usart_write(line, n);
+
+    if (same) {
+        usart_puts_const("\r\n");
+    } else {
+        usart_puts_const(" - results differ\r\n");
+    }
+}
+
+/**
+ * @brief Enable the DWT cycle counter and clear all probes
+ */
+void prof_init(void) {
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    prof_reset();
+}
+
+/**
+ * @brief Clear all probe records
+ */
+void prof_reset(void) {
+#if PROFILING
+    for (uint32_t i = 0; i < PROF_PROBE_COUNT; i++) {
+        prof_probes[i].count = 0;
+        prof_probes[i].min   = 0xFFFFFFFFU;
+        prof_probes[i].max   = 0;
+        prof_probes[i].total = 0;
+    }
+#endif
+}
+
+/**
+ * @brief Write the probe table to USART1 as text (blocks until queued)
+ */
+void prof_dump(void) {
+#if PROFILING
+    usart_puts_const("probe                 count        min        max       mean\r\n");
+
+    for (uint32_t i = 0; i < PROF_PROBE_COUNT; i++) {
+        const prof_probe_t* probe = &prof_probes[i];
+        char line[PROF_NAME_WIDTH + 4U * (PROF_VALUE_WIDTH + 1U) + 2U];
+        uint32_t n = 0;
+        uint32_t mean = probe->count ? (uint32_t)(probe->total / probe->count) : 0U;
+
+        for (const char* name = prof_names[i]; *name && (n < PROF_NAME_WIDTH); name++) {
+            line[n++] = *name;
+        }
+        while (n < PROF_NAME_WIDTH) {
+            line[n++] = ' ';
+        }
+
+        n += fmt_u32_pad(&line[n], probe->count, PROF_VALUE_WIDTH, ' ');
+        n += fmt_u32_pad(&line[n], probe->count ? probe->min : 0U, PROF_VALUE_WIDTH, ' ');
+        n += fmt_u32_pad(&line[n], probe->max, PROF_VALUE_WIDTH, ' ');
+        n += fmt_u32_pad(&line[n], mean, PROF_VALUE_WIDTH, ' ');
+        line[n++] = '\r';
+        line[n++] = '\n';
+        usart_write(line, n);
+    }
+#else
+    usart_puts_const("profiling disabled - build with PROFILE=1\r\n");
+#endif
+}
+
+/**
+ * @brief Time the CRC kernel from flash and from SRAM, and the div/mod
+ *        formatter against fmt_u32(), and print both comparisons
+ */
+void prof_bench(void) {
+    uint8_t data[PROF_BENCH_BYTES];
+    uint32_t values[PROF_BENCH_VALUES];
+    uint32_t crc_flash, crc_sram, flash, sram;
+    uint32_t len_divmod, len_fmt, divmod, fast;
+    uint32_t same = 1U;
+
+    for (uint32_t i = 0; i < PROF_BENCH_BYTES; i++) {
+        data[i] = (uint8_t)(i * 37U + 11U);
+    }
+
+    flash = prof_bench_time(prof_bench_flash, data, &crc_flash);
+    sram  = prof_bench_time(prof_bench_sram, data, &crc_sram);
+    prof_bench_report("flash / sram", flash, sram, crc_flash == crc_sram);
+
+    /* Shifting a full-width value right by 0..31 covers every length */
+    for (uint32_t i = 0; i < PROF_BENCH_VALUES; i++) {
+        char a[FMT_U32_MAX], b[FMT_U32_MAX];
+        uint32_t n;
+
+        values[i] = (0x9E3779B9U * (i + 1U)) >> i;
+        n = prof_bench_divmod(a, values[i]);
+        if (n != fmt_u32(b, values[i])) {
+            same = 0;
+        }
+        for (uint32_t k = 0; same && (k < n); k++) {
+            same = (a[k] == b[k]);
+        }
+    }
+
+    divmod = prof_bench_fmt_time(prof_bench_divmod, values, &len_divmod);
+    fast   = prof_bench_fmt_time(fmt_u32, values, &len_fmt);
+    prof_bench_report("div-mod / fmt_u32", divmod, fast, same && (len_divmod == len_fmt));
+}
@@ -0,0 +1,136 @@
+/**
+ * DWT Cycle-Counter Profiling Probes
+ *
+ * Purpose: Measure how many core cycles named code regions take
+ * Features: Probes declared once in PROF_PROBE_LIST; each records count,
+ *           min, max and total cycles; table dump over USART1
+ * Performance: A probe is one CYCCNT load at entry and, at exit, a load,
+ *              a subtract and four read-modify-writes on its record. With
+ *              PROFILING=0 (default) every macro expands to nothing.
+ * Usage: Add a name to PROF_PROBE_LIST, then bracket the code
+ *
+ *   PROF_BEGIN(crm_config);
+ *   crm_config();
+ *   PROF_END(crm_config);
+ *
+ *   void usart_puts(const char* str) {
+ *       PROF_SCOPE(usart_puts);     // recorded when the scope is left
+ *       ...
+ *   }
+ *
+ * Configuration Options:
+ *   • PROFILING: 1 = probes active (pass PROFILE=1 to make), 0 = removed
+ *
+ * Note: A probe's record is not protected against concurrent updates -
+ *       use each probe from one execution context only. CYCCNT does not
+ *       advance while the core sleeps in __WFE().
+ */
+
+#ifndef PROF_H
+#define PROF_H
+
+#include "at32f421.h"
+
+#ifndef PROFILING
+  #define PROFILING                   0
+#endif
+
+/* Every probe in the firmware - one X(name) entry each */
+#define PROF_PROBE_LIST(X)                                                      \
+    X(crm_config)                                                               \
+    X(main_loop)                                                                \
+    X(dispatch_run)                                                             \
+    X(event_dispatch)                                                           \
+    X(sched_run)                                                                \
+    X(usart_puts)
+
+/**
+ * @brief Probe identifiers
+ */
+typedef enum {
+#define PROF_ID_ENTRY_(name)        PROF_ID_##name,
+    PROF_PROBE_LIST(PROF_ID_ENTRY_)
+#undef PROF_ID_ENTRY_
+    PROF_PROBE_COUNT
+} prof_id_t;
+
+/**
+ * @brief Accumulated measurements of one probe
+ */
+typedef struct {
+    uint32_t count;                 /*!< Completed measurements */
+    uint32_t min;                   /*!< Shortest, in cycles */
+    uint32_t max;                   /*!< Longest, in cycles */
+    uint64_t total;                 /*!< Sum, in cycles (mean = total / count) */
+} prof_probe_t;
+
+#if PROFILING
+
+extern prof_probe_t prof_probes[PROF_PROBE_COUNT];
+
+/**
+ * @brief Add one measurement to a probe
+ */
+static inline void prof_record(prof_id_t id, uint32_t cycles) {
+    prof_probe_t* probe = &prof_probes[id];
+
+    probe->count++;
+    probe->total += cycles;
+    if (cycles < probe->min) {
+        probe->min = cycles;
+    }
+    if (cycles > probe->max) {
+        probe->max = cycles;
+    }
+}
+
+/* Scope-exit recorders for PROF_SCOPE(), one per probe */
+#define PROF_SCOPE_END_(name)                                                   \
+    static inline void prof_scope_end_##name(const uint32_t* start) {           \
+        prof_record(PROF_ID_##name, DWT->CYCCNT - *start);                      \
+    }
+PROF_PROBE_LIST(PROF_SCOPE_END_)
+#undef PROF_SCOPE_END_
+
+#define PROF_BEGIN(name)            const uint32_t prof_start_##name = DWT->CYCCNT
+#define PROF_END(name)              prof_record(PROF_ID_##name, DWT->CYCCNT - prof_start_##name)
+#define PROF_SCOPE(name)                                                        \
+    const uint32_t prof_scope_##name                                            \
+        __attribute__((cleanup(prof_scope_end_##name))) = DWT->CYCCNT
+
+#else
+
+#define PROF_BEGIN(name)            do { } while (0)
+#define PROF_END(name)              do { } while (0)
+#define PROF_SCOPE(name)            do { } while (0)
+
+#endif /* PROFILING */
+
+/**
+ * @brief Enable the DWT cycle counter and clear all probes
+ * @note The counter is started even with PROFILING=0, so other code may
+ *       read DWT->CYCCNT.
+ */
+void prof_init(void);
+
+/**
+ * @brief Clear all probe records
+ */
+void prof_reset(void);
+
+/**
+ * @brief Write the probe table to USART1 as text (blocks until queued)
+ */
+void prof_dump(void);
+
+/**
+ * @brief Time a CRC-32 kernel run from flash and from SRAM, and
+ *        fmt_u32() against the div/mod loop it replaced, and print the
+ *        cycles and speedups (available with PROFILING=0)
+ * @note Interrupts are masked during each measurement. With RAMFUNC=0
+ *       both CRC copies run from flash. Both formatters run from the same
+ *       memory, and their output is compared before timing.
+ */
+void prof_bench(void);
+
+#endif /* PROF_H */
@@ -0,0 +1,47 @@
+/**
+ * Code Execution from SRAM
+ *
+ * Purpose: Run hot paths (interrupt handlers, formatter, main-loop dispatch)
+ *          from SRAM, where instruction fetches take no flash wait states
+ * Features: RAMFUNC attribute for definitions; the code goes to the
+ *           .ramfunc input section, which the linker script places in the
+ *           .data output section, so the startup's .data copy loop loads
+ *           it into SRAM together with the initialised variables
+ * Performance: At 120MHz flash needs 3 wait states; the prefetch buffer
+ *              hides them for straight-line code, but every taken branch
+ *              refills it. Code in SRAM fetches every instruction in a
+ *              single cycle (`prof bench` measures the difference).
+ *              Calls between flash and SRAM are beyond BL range, so the
+ *              linker routes them through a long-branch veneer (3 cycles).
+ * Usage: Mark the definition - prototypes need no change
+ *
+ *   RAMFUNC void USART1_IRQHandler(void) {
+ *       ...
+ *   }
+ *
+ * Configuration Options:
+ *   • RAMFUNC_ENABLE: 1 = RAMFUNC code runs from SRAM (default),
+ *                     0 = everything stays in flash (pass RAMFUNC=0 to make)
+ *
+ * Note: RAMFUNC implies noinline - code inlined into a flash caller would
+ *       run from flash. Static helpers called only from a RAMFUNC are still
+ *       inlined into it; shared helpers need their own RAMFUNC. Constant
+ *       tables stay in flash. `make ramfunc` lists what landed in SRAM.
+ *       The section name avoids a ".data" prefix: the assembler would
+ *       warn about code ("ax") in a section it knows as writable data.
+ */
+
+#ifndef RAMFUNC_H
+#define RAMFUNC_H
+
+#ifndef RAMFUNC_ENABLE
+  #define RAMFUNC_ENABLE              1
+#endif
+
+#if RAMFUNC_ENABLE
+  #define RAMFUNC                     __attribute__((section(".ramfunc"), noinline))
+#else
+  #define RAMFUNC
+#endif
+
+#endif /* RAMFUNC_H */
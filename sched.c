@@ -0,0 +1,151 @@
+/**
+ * Cooperative Stackless Task Scheduler Implementation
+ *
+ * Slots are kept sorted by priority, and slot n is bit (31 - n) of the
+ * ready bitmap, so __CLZ() of the bitmap is the slot to run next.
+ */
+
+#include <stddef.h>
+#include "at32f421.h"
+#include "sched.h"
+
+#define SCHED_SLOT_BIT(n)           (0x80000000U >> (n))
+
+/**
+ * @brief Per-task RAM state
+ */
+typedef struct {
+    const sched_task_t* task;
+    uint32_t release;               /*!< Tick of the next timed release */
+    uint32_t events;                /*!< Signalled events not yet delivered */
+} sched_slot_t;
+
+static sched_slot_t sched_slots[SCHED_MAX_TASKS];
+static uint32_t sched_count = 0;
+static uint32_t sched_ready = 0;
+
+/* Events signalled since the last sched_run(), written by interrupts */
+static volatile uint32_t sched_events = 0;
+
+static sched_stats_t sched_statistics;
+
+/**
+ * @brief Add a task
+ */
+sched_status_t sched_add(const sched_task_t* task, uint32_t first_delay) {
+    uint32_t slot;
+
+    if ((task == NULL) || (task->fn == NULL) ||
+        ((task->period == 0U) && (task->event_mask == 0U))) {
+        return SCHED_ERR_INVALID;
+    }
+    if (sched_count >= SCHED_MAX_TASKS) {
+        return SCHED_ERR_FULL;
+    }
+
+    /* Insert behind every task of the same or higher priority */
+    slot = sched_count;
+    while ((slot > 0U) && (sched_slots[slot - 1U].task->priority > task->priority)) {
+        sched_slots[slot] = sched_slots[slot - 1U];
+        slot--;
+    }
+
+    /* Ready bits of shifted tasks move with them */
+    sched_ready = (sched_ready & ~(0xFFFFFFFFU >> slot)) |
+                  ((sched_ready & (0xFFFFFFFFU >> slot)) >> 1);
+
+    sched_slots[slot].task    = task;
+    sched_slots[slot].release = sched_statistics.ticks + first_delay;
+    sched_slots[slot].events  = 0;
+    sched_count++;
+
+    /* A zero delay releases the task now; the next release is one period on */
+    if ((task->period != 0U) && (first_delay == 0U)) {
+        sched_slots[slot].release += task->period;
+        sched_ready |= SCHED_SLOT_BIT(slot);
+    }
+    return SCHED_OK;
+}
+
+/**
+ * @brief Signal events - callable from interrupt handlers
+ */
+void sched_signal(uint32_t events) {
+    do {
+        /* Nested signallers retry instead of losing bits */
+    } while (__STREXW(__LDREXW(&sched_events) | events, &sched_events));
+}
+
+/**
+ * @brief Advance scheduler time by one tick and release due tasks
+ */
+void sched_tick(void) {
+    uint32_t now = ++sched_statistics.ticks;
+
+    for (uint32_t slot = 0; slot < sched_count; slot++) {
+        sched_slot_t* s = &sched_slots[slot];
+        uint32_t period = s->task->period;
+
+        if ((period != 0U) && ((int32_t)(now - s->release) >= 0)) {
+            if (sched_ready & SCHED_SLOT_BIT(slot)) {
+                sched_statistics.deadline_misses++;
+            }
+            sched_ready |= SCHED_SLOT_BIT(slot);
+            s->release += period;
+        }
+    }
+}
+
+/**
+ * @brief Move signalled events to the tasks waiting for them
+ */
+static void sched_collect_events(void) {
+    uint32_t events;
+
+    do {
+        events = __LDREXW(&sched_events);
+    } while (__STREXW(0U, &sched_events));
+
+    if (events == 0U) {
+        return;
+    }
+    for (uint32_t slot = 0; slot < sched_count; slot++) {
+        uint32_t matched = events & sched_slots[slot].task->event_mask;
+
+        if (matched) {
+            sched_slots[slot].events |= matched;
+            sched_ready |= SCHED_SLOT_BIT(slot);
+        }
+    }
+}
+
+/**
+ * @brief Run ready tasks until none is left
+ */
+uint32_t sched_run(void) {
+    uint32_t count = 0;
+
+    sched_collect_events();
+    while (sched_ready) {
+        uint32_t slot = __CLZ(sched_ready);
+        uint32_t events = sched_slots[slot].events;
+
+        sched_ready &= ~SCHED_SLOT_BIT(slot);
+        sched_slots[slot].events = 0;
+        sched_slots[slot].task->fn(events);
+        count++;
+
+        /* Tasks may signal each other; pick that up before going idle */
+        sched_collect_events();
+    }
+
+    sched_statistics.runs += count;
+    return count;
+}
+
+/**
+ * @brief Scheduler statistics since reset
+ */
+const sched_stats_t* sched_stats(void) {
+    return &sched_statistics;
+}
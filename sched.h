@@ -0,0 +1,118 @@
+/**
+ * Cooperative Stackless Task Scheduler
+ *
+ * Purpose: Run many periodic and event-driven jobs from the __WFE() main loop
+ * Features: Run-to-completion tasks with a priority, a period (release
+ *           deadline) and an event mask; ISR-safe event signalling
+ * Performance: Tasks share the main stack - RAM per task is 12 bytes (task
+ *              pointer, next release, pending events); the next task to run
+ *              is found with one CLZ on the ready bitmap
+ * Usage: Describe tasks in const tables, add them once, then call
+ *        sched_run() after every wakeup
+ *
+ *   static void blink(uint32_t events) { ... }
+ *   static const sched_task_t blink_task = {
+ *       .fn = blink, .priority = 2, .period = 5, .event_mask = 0
+ *   };
+ *
+ *   sched_add(&blink_task, 0);
+ *   while (1) {
+ *       dispatch_wait();            // core sleeps here when nothing is ready
+ *       dispatch_run();             // sources call sched_tick()/sched_signal()
+ *       sched_run();
+ *   }
+ *
+ * Scheduling Rules:
+ *   • A task is ready when one of its events was signalled, or when its
+ *     release time (in scheduler ticks) has come
+ *   • The ready task with the highest priority (0 = highest) runs first;
+ *     equal priorities run in the order they were added
+ *   • Tasks never block: they return, and are re-run on their next release
+ *     or event. A task still waiting when its next release arrives counts
+ *     as a deadline miss
+ *
+ * Configuration Options:
+ *   • SCHED_MAX_TASKS: Number of task slots, at most 32 (default: 24)
+ *
+ * Note: sched_signal() may be called from interrupt handlers; everything
+ *       else runs in thread context.
+ */
+
+#ifndef SCHED_H
+#define SCHED_H
+
+#include <stdint.h>
+
+#ifndef SCHED_MAX_TASKS
+  #define SCHED_MAX_TASKS             24U
+#endif
+
+#if (SCHED_MAX_TASKS < 1U) || (SCHED_MAX_TASKS > 32U)
+  #error "SCHED_MAX_TASKS must be between 1 and 32"
+#endif
+
+/**
+ * @brief Scheduler operation result codes
+ */
+typedef enum {
+    SCHED_OK = 0,                   /*!< Task added */
+    SCHED_ERR_FULL,                 /*!< All SCHED_MAX_TASKS slots in use */
+    SCHED_ERR_INVALID               /*!< No function, or neither period nor events */
+} sched_status_t;
+
+/**
+ * @brief Task body - runs to completion
+ * @param events Signalled events from the task's mask (0 for a timed release)
+ */
+typedef void (*sched_fn_t)(uint32_t events);
+
+/**
+ * @brief Task description, normally a const object in flash
+ */
+typedef struct {
+    sched_fn_t fn;                  /*!< Task body */
+    uint32_t priority;              /*!< 0 = highest */
+    uint32_t period;                /*!< Release interval in ticks, 0 = event-driven only */
+    uint32_t event_mask;            /*!< Events that make the task ready */
+} sched_task_t;
+
+/**
+ * @brief Scheduler statistics
+ */
+typedef struct {
+    uint32_t runs;                  /*!< Task bodies executed */
+    uint32_t deadline_misses;       /*!< Releases that found the task still waiting */
+    uint32_t ticks;                 /*!< Scheduler time */
+} sched_stats_t;
+
+/**
+ * @brief Add a task
+ * @param task        Task description (must stay valid)
+ * @param first_delay Ticks until the first timed release
+ * @return SCHED_OK or the reason for rejection
+ */
+sched_status_t sched_add(const sched_task_t* task, uint32_t first_delay);
+
+/**
+ * @brief Signal events - callable from interrupt handlers
+ * @param events Event bits; every task whose mask matches becomes ready
+ */
+void sched_signal(uint32_t events);
+
+/**
+ * @brief Advance scheduler time by one tick and release due tasks
+ */
+void sched_tick(void);
+
+/**
+ * @brief Run ready tasks until none is left
+ * @return Number of task bodies executed
+ */
+uint32_t sched_run(void);
+
+/**
+ * @brief Scheduler statistics since reset
+ */
+const sched_stats_t* sched_stats(void);
+
+#endif /* SCHED_H */
@@ -50,6 +50,7 @@ CMSIS_FILES=(
 # Driver files
 DRIVER_FILES=(
     "at32f421_crm.h"
+    "at32f421_dma.h"
     "at32f421_flash.h"
     "at32f421_tmr.h"
     "at32f421_def.h"
@@ -72,7 +73,6 @@ download_files "$BASE_URL/cmsis/cm4/core_support" "inc" "${CMSIS_FILES[@]}"
 download_files "$BASE_URL/drivers/inc" "inc" "${DRIVER_FILES[@]}"
 download_files "$BASE_URL/cmsis/cm4/device_support" "inc" "${DEVICE_FILES[@]}"
 download_files "$BASE_URL/cmsis/cm4/device_support" "." "system_at32f421.c"
-download_files "$BASE_URL/cmsis/cm4/device_support/startup/gcc" "." "startup_at32f421.s"
 download_files "$BASE_URL/cmsis/cm4/device_support/startup/gcc/linker" "." "AT32F421x8_FLASH.ld"
 
 
@@ -92,6 +92,7 @@ if [[ -f "$CONF_TEMPLATE" ]]; then
     # List of enabled modules
     ENABLED_MODULES=(
         "CRM_MODULE_ENABLED"
+        "DMA_MODULE_ENABLED"
         "TMR_MODULE_ENABLED"
         "USART_MODULE_ENABLED"
         "GPIO_MODULE_ENABLED"
@@ -116,25 +117,33 @@ else
 fi
 
 
-# --- Disable __libc_init_array in startup file ---
-STARTUP_FILE="startup_at32f421.s"
+# --- Include the project sections in the linker script ---
+LINKER_FILE="AT32F421x8_FLASH.ld"
 
-if [[ -f "$STARTUP_FILE" ]]; then
-    echo "Patching $STARTUP_FILE (disabling __libc_init_array)..."
-
-    # Create a backup
-    cp "$STARTUP_FILE" "${STARTUP_FILE}.bak"
-
-    # sed expression: replace line "bl __libc_init_array" with "@ bl __libc_init_array"
-    if sed --version >/dev/null 2>&1; then
-        # GNU sed
-        sed -E -i 's/^([[:space:]]*)bl[[:space:]]+__libc_init_array/\1@ bl __libc_init_array/' "$STARTUP_FILE"
+if [[ -f "$LINKER_FILE" ]]; then
+    if grep -q "INCLUDE sections.ld" "$LINKER_FILE"; then
+        echo "✓ $LINKER_FILE already includes sections.ld."
     else
-        # BSD/macOS sed
-        sed -E -i '' 's/^([[:space:]]*)bl[[:space:]]+__libc_init_array/\1@ bl __libc_init_array/' "$STARTUP_FILE"
+        echo "Patching $LINKER_FILE (.ramfunc in .data, sections.ld after .bss)..."
+
+        # Create a backup
+        cp "$LINKER_FILE" "${LINKER_FILE}.bak"
+
+        # awk: add RAMFUNC code after "*(.data*)", ahead of the _edata
+        # alignment, so the startup copies it with the variables. After the
+        # line that sets _ebss, the next closing brace ends .bss; emit the
+        # INCLUDE right after it.
+        if awk '{ print }
+             /^[[:space:]]*\*\(\.data\*\)/ && !ramfunc { print "    *(.ramfunc*)       /* RAMFUNC code (ramfunc.h) */"; ramfunc = 1 }
+             /_ebss[[:space:]]*=/ { in_bss = 1 }
+             in_bss && /^[[:space:]]*}/ { print "  INCLUDE sections.ld"; in_bss = 0; include = 1 }
+             END { exit !(ramfunc && include) }' "${LINKER_FILE}.bak" > "$LINKER_FILE"; then
+            echo "✓ Patched $LINKER_FILE (.ramfunc and sections.ld added)."
+        else
+            cp "${LINKER_FILE}.bak" "$LINKER_FILE"
+            echo "✗ *(.data*) or end of .bss not found in $LINKER_FILE. Skipping patch."
+        fi
     fi
-
-    echo "✓ Patched $STARTUP_FILE (line commented out)."
 else
-    echo "✗ Startup file $STARTUP_FILE not found. Skipping patch."
+    echo "✗ Linker script $LINKER_FILE not found. Skipping patch."
 fi
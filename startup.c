@@ -0,0 +1,224 @@
+/**
+ * C Startup Code Implementation
+ *
+ * Runs before .data and .bss exist: nothing here may read a variable
+ * before startup_copy() and startup_fill() are done.
+ */
+
+#include "startup.h"
+
+/* Provided by the vendor linker script and sections.ld */
+extern uint32_t _estack;
+extern uint32_t _sidata, _sdata, _edata;
+extern uint32_t _sbss, _ebss;
+extern uint32_t __noinit_start, __noinit_end;
+
+int main(void);
+
+typedef void (*startup_vector_t)(void);
+
+static uint32_t main_cycles;
+
+/**
+ * @brief Copy words from src to [dst, end) - four per LDM/STM pair
+ *
+ * Inlined, so Reset_Handler() needs no frame below its own; that keeps the
+ * stack painting from overwriting live data.
+ */
+static inline __attribute__((always_inline))
+void startup_copy(uint32_t* dst, const uint32_t* src, const uint32_t* end) {
+    uint32_t blocks = ((uint32_t)end - (uint32_t)dst) >> 4;
+
+    if (blocks) {
+        __asm volatile(
+            "1: ldmia %[src]!, {r2-r5}     \n"
+            "   stmia %[dst]!, {r2-r5}     \n"
+            "   subs  %[n], %[n], #1       \n"
+            "   bne   1b                   \n"
+            : [dst] "+r" (dst), [src] "+r" (src), [n] "+r" (blocks)
+            :
+            : "r2", "r3", "r4", "r5", "cc", "memory");
+    }
+    while (dst < end) {
+        *dst++ = *src++;
+    }
+}
+
+/**
+ * @brief Fill [dst, end) with value - four words per STM
+ */
+static inline __attribute__((always_inline))
+void startup_fill(uint32_t* dst, const uint32_t* end, uint32_t value) {
+    uint32_t blocks = ((uint32_t)end - (uint32_t)dst) >> 4;
+
+    if (blocks) {
+        __asm volatile(
+            "   mov   r2, %[v]             \n"
+            "   mov   r3, %[v]             \n"
+            "   mov   r4, %[v]             \n"
+            "   mov   r5, %[v]             \n"
+            "1: stmia %[dst]!, {r2-r5}     \n"
+            "   subs  %[n], %[n], #1       \n"
+            "   bne   1b                   \n"
+            : [dst] "+r" (dst), [n] "+r" (blocks)
+            : [v] "r" (value)
+            : "r2", "r3", "r4", "r5", "cc", "memory");
+    }
+    while (dst < end) {
+        *dst++ = value;
+    }
+}
+
+/**
+ * @brief Reset entry - memory init, SystemInit(), then main()
+ */
+void Reset_Handler(void) {
+    /* Count cycles from here; prof_init() restarts the counter later */
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    startup_copy(&_sdata, &_sidata, &_edata);
+    startup_fill(&_sbss, &_ebss, 0U);
+#if !STARTUP_NOINIT_KEEP
+    startup_fill(&__noinit_start, &__noinit_end, 0U);
+#endif
+#if STARTUP_STACK_PAINT
+    /* Everything below the current stack pointer is unused so far */
+    startup_fill(&__noinit_end, (const uint32_t*)(__get_MSP() & ~3U), STARTUP_STACK_PATTERN);
+#endif
+
+    SystemInit();
+
+    main_cycles = DWT->CYCCNT;
+    (void)main();
+
+    while (1) {
+        /* main() does not return */
+    }
+}
+
+/**
+ * @brief Handler for every exception nobody claimed
+ */
+void Default_Handler(void) {
+    while (1) {
+        __NOP();
+    }
+}
+
+#define STARTUP_WEAK                __attribute__((weak, alias("Default_Handler")))
+
+void NMI_Handler(void) STARTUP_WEAK;
+void HardFault_Handler(void) STARTUP_WEAK;
+void MemManage_Handler(void) STARTUP_WEAK;
+void BusFault_Handler(void) STARTUP_WEAK;
+void UsageFault_Handler(void) STARTUP_WEAK;
+void SVC_Handler(void) STARTUP_WEAK;
+void DebugMon_Handler(void) STARTUP_WEAK;
+void PendSV_Handler(void) STARTUP_WEAK;
+void SysTick_Handler(void) STARTUP_WEAK;
+
+void WWDT_IRQHandler(void) STARTUP_WEAK;
+void PVM_IRQHandler(void) STARTUP_WEAK;
+void ERTC_IRQHandler(void) STARTUP_WEAK;
+void FLASH_IRQHandler(void) STARTUP_WEAK;
+void CRM_IRQHandler(void) STARTUP_WEAK;
+void EXINT1_0_IRQHandler(void) STARTUP_WEAK;
+void EXINT3_2_IRQHandler(void) STARTUP_WEAK;
+void EXINT15_4_IRQHandler(void) STARTUP_WEAK;
+void DMA1_Channel1_IRQHandler(void) STARTUP_WEAK;
+void DMA1_Channel3_2_IRQHandler(void) STARTUP_WEAK;
+void DMA1_Channel5_4_IRQHandler(void) STARTUP_WEAK;
+void ADC1_CMP_IRQHandler(void) STARTUP_WEAK;
+void TMR1_BRK_OVF_TRG_HALL_IRQHandler(void) STARTUP_WEAK;
+void TMR1_CH_IRQHandler(void) STARTUP_WEAK;
+void TMR3_GLOBAL_IRQHandler(void) STARTUP_WEAK;
+void TMR6_GLOBAL_IRQHandler(void) STARTUP_WEAK;
+void TMR14_GLOBAL_IRQHandler(void) STARTUP_WEAK;
+void TMR15_GLOBAL_IRQHandler(void) STARTUP_WEAK;
+void TMR16_GLOBAL_IRQHandler(void) STARTUP_WEAK;
+void TMR17_GLOBAL_IRQHandler(void) STARTUP_WEAK;
+void I2C1_EVT_IRQHandler(void) STARTUP_WEAK;
+void I2C2_EVT_IRQHandler(void) STARTUP_WEAK;
+void SPI1_IRQHandler(void) STARTUP_WEAK;
+void SPI2_IRQHandler(void) STARTUP_WEAK;
+void USART1_IRQHandler(void) STARTUP_WEAK;
+void USART2_IRQHandler(void) STARTUP_WEAK;
+void I2C1_ERR_IRQHandler(void) STARTUP_WEAK;
+void I2C2_ERR_IRQHandler(void) STARTUP_WEAK;
+
+/* Same layout as the vendor table; the IRQn comments match at32f421.h */
+__attribute__((section(".isr_vector"), used))
+static const startup_vector_t startup_vectors[] = {
+    (startup_vector_t)&_estack,
+    Reset_Handler,
+    NMI_Handler,
+    HardFault_Handler,
+    MemManage_Handler,
+    BusFault_Handler,
+    UsageFault_Handler,
+    0, 0, 0, 0,
+    SVC_Handler,
+    DebugMon_Handler,
+    0,
+    PendSV_Handler,
+    SysTick_Handler,
+
+    WWDT_IRQHandler,                        /* 0 */
+    PVM_IRQHandler,
+    ERTC_IRQHandler,
+    FLASH_IRQHandler,
+    CRM_IRQHandler,
+    EXINT1_0_IRQHandler,                    /* 5 */
+    EXINT3_2_IRQHandler,
+    EXINT15_4_IRQHandler,
+    0,
+    DMA1_Channel1_IRQHandler,
+    DMA1_Channel3_2_IRQHandler,             /* 10 */
+    DMA1_Channel5_4_IRQHandler,
+    ADC1_CMP_IRQHandler,
+    TMR1_BRK_OVF_TRG_HALL_IRQHandler,
+    TMR1_CH_IRQHandler,
+    0,                                      /* 15 */
+    TMR3_GLOBAL_IRQHandler,
+    TMR6_GLOBAL_IRQHandler,
+    0,
+    TMR14_GLOBAL_IRQHandler,
+    TMR15_GLOBAL_IRQHandler,                /* 20 */
+    TMR16_GLOBAL_IRQHandler,
+    TMR17_GLOBAL_IRQHandler,
+    I2C1_EVT_IRQHandler,
+    I2C2_EVT_IRQHandler,
+    SPI1_IRQHandler,                        /* 25 */
+    SPI2_IRQHandler,
+    USART1_IRQHandler,
+    USART2_IRQHandler,
+    0,
+    I2C1_ERR_IRQHandler,                    /* 30 */
+    0,
+    I2C2_ERR_IRQHandler
+};
+
+/**
+ * @brief Core cycles from Reset_Handler() entry to the call of main()
+ */
+uint32_t startup_main_cycles(void) {
+    return main_cycles;
+}
+
+/**
+ * @brief Bytes at the bottom of the free SRAM the stack has never reached
+ */
+uint32_t startup_stack_unused(void) {
+#if STARTUP_STACK_PAINT
+    const uint32_t* word = &__noinit_end;
+
+    while ((word < &_estack) && (*word == STARTUP_STACK_PATTERN)) {
+        word++;
+    }
+    return (uint32_t)(word - &__noinit_end) * 4U;
+#else
+    return 0;
+#endif
+}
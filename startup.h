@@ -0,0 +1,63 @@
+/**
+ * C Startup Code
+ *
+ * Purpose: Own the path from reset to main() - replaces the downloaded and
+ *          patched startup_at32f421.s
+ * Features: Vector table with the vendor handler names, each a weak alias
+ *           of Default_Handler; .data copied and .bss zeroed 16 bytes per
+ *           LDM/STM pair; .noinit left untouched across resets; optional
+ *           stack painting with a high-water mark; reset-to-main cycle count
+ * Performance: Four words move per loop pass, so the copy costs little
+ *              more than the bus accesses themselves. Stack painting fills
+ *              all free SRAM once (about 1ms on HICK for 14KB) and is off
+ *              by default.
+ * Usage: Nothing to call - Reset_Handler() runs SystemInit() and main().
+ *        Keep a variable across resets with NOINIT, and read the results:
+ *
+ *   static NOINIT uint32_t reset_count;
+ *
+ *   LOG_INFO("main after %u cycles", startup_main_cycles());
+ *   LOG_INFO("stack never used: %u bytes", startup_stack_unused());
+ *
+ * Configuration Options:
+ *   • STARTUP_NOINIT_KEEP: 1 = .noinit survives resets (default),
+ *                          0 = zeroed with .bss (pass NOINIT_CLEAR=1 to make)
+ *   • STARTUP_STACK_PAINT: 1 = fill free SRAM with STARTUP_STACK_PATTERN
+ *                          (pass STACK_PAINT=1 to make), 0 = skip (default)
+ *
+ * Note: .noinit holds garbage after power-on - guard its contents with a
+ *       magic value. Handlers are overridden by defining a function of the
+ *       same name (NMI_Handler in crm.c, USART1_IRQHandler in usart.c).
+ */
+
+#ifndef STARTUP_H
+#define STARTUP_H
+
+#include "at32f421.h"
+
+#ifndef STARTUP_NOINIT_KEEP
+  #define STARTUP_NOINIT_KEEP         1
+#endif
+
+#ifndef STARTUP_STACK_PAINT
+  #define STARTUP_STACK_PAINT         0
+#endif
+
+#define STARTUP_STACK_PATTERN       0xA5A5A5A5U
+
+/* Place a variable in .noinit (see STARTUP_NOINIT_KEEP) */
+#define NOINIT                      __attribute__((section(".noinit")))
+
+/**
+ * @brief Core cycles from Reset_Handler() entry to the call of main()
+ * @note Counted on HICK (CRM_HICK_HZ), before any clock setup.
+ */
+uint32_t startup_main_cycles(void);
+
+/**
+ * @brief Bytes at the bottom of the free SRAM the stack has never reached
+ * @return 0 with STARTUP_STACK_PAINT=0
+ */
+uint32_t startup_stack_unused(void);
+
+#endif /* STARTUP_H */
@@ -0,0 +1,325 @@
+/**
+ * Software Timers on a Hierarchical Timing Wheel - Implementation
+ *
+ * Wheel time (wheel_now) is only advanced by swtimer_process(); the
+ * hardware counter value that corresponds to it is kept in wheel_count_ref,
+ * so the real time is wheel_now plus the counts elapsed since.
+ *
+ * Invariant: every timer at level n has an expiry that agrees with
+ * wheel_now in all bits above level n and has a larger level-n digit.
+ * Occupied slots therefore always lie ahead of the wheel, and the next
+ * interesting time per level is given by its lowest occupied slot.
+ */
+
+#include <stddef.h>
+#include "swtimer.h"
+#include "timer.h"
+
+#define SWTIMER_SLOT_BITS           5U
+#define SWTIMER_SLOTS               (1U << SWTIMER_SLOT_BITS)
+#define SWTIMER_SLOT_MASK           (SWTIMER_SLOTS - 1U)
+
+/* Slot n is bit (31 - n), so __CLZ() returns the lowest occupied slot */
+#define SWTIMER_SLOT_BIT(n)         (0x80000000U >> (n))
+
+static swtimer_t* wheel[SWTIMER_LEVELS][SWTIMER_SLOTS];
+static uint32_t wheel_occupied[SWTIMER_LEVELS];
+
+static uint32_t wheel_now = 0;
+static uint32_t wheel_count_ref = 0;
+
+/* Part of a count not yet applied by swtimer_advance_us() */
+static uint32_t advance_rem_us = 0;
+
+#define SWTIMER_US_PER_COUNT        (1000000U / SWTIMER_COUNT_HZ)
+
+/**
+ * @brief Keep the wheel's count rate across system clock changes
+ */
+static void swtimer_clock_notify(crm_clock_event_t event) {
+    if (event == CRM_CLOCK_POST_CHANGE) {
+        tmr_div_set_now(SWTIMER_TMR, crm_get_clocks()->tmr_hz / SWTIMER_COUNT_HZ - 1U);
+    }
+}
+
+/**
+ * @brief Non-zero if no timer is running
+ */
+static uint32_t wheel_empty(void) {
+    uint32_t occupied = 0;
+
+    for (uint32_t level = 0; level < SWTIMER_LEVELS; level++) {
+        occupied |= wheel_occupied[level];
+    }
+    return occupied == 0U;
+}
+
+/**
+ * @brief Milliseconds elapsed on the hardware counter since wheel_now
+ */
+static uint32_t wheel_elapsed(void) {
+    return ((SWTIMER_TMR->cval - wheel_count_ref) & 0xFFFFU) / SWTIMER_COUNTS_PER_MS;
+}
+
+/**
+ * @brief Move wheel time forward to t (no slot crosses in between)
+ */
+static void wheel_advance(uint32_t t) {
+    wheel_count_ref += (t - wheel_now) * SWTIMER_COUNTS_PER_MS;
+    wheel_now = t;
+}
+
+/**
+ * @brief Link a timer into the slot for its expiry - O(1)
+ */
+static void wheel_insert(swtimer_t* timer) {
+    uint32_t diff = timer->expiry ^ wheel_now;
+    uint32_t level = diff ? (31U - __CLZ(diff)) / SWTIMER_SLOT_BITS : 0U;
+    uint32_t slot = (timer->expiry >> (SWTIMER_SLOT_BITS * level)) & SWTIMER_SLOT_MASK;
+    swtimer_t** head = &wheel[level][slot];
+
+    timer->next = *head;
+    if (timer->next != NULL) {
+        timer->next->pprev = &timer->next;
+    }
+    *head = timer;
+    timer->pprev = head;
+    wheel_occupied[level] |= SWTIMER_SLOT_BIT(slot);
+}
+
+/**
+ * @brief Unlink a timer - O(1); clears the slot bit when the slot empties
+ */
+static void wheel_remove(swtimer_t* timer) {
+    swtimer_t** pprev = timer->pprev;
+
+    *pprev = timer->next;
+    if (timer->next != NULL) {
+        timer->next->pprev = pprev;
+    }
+    timer->pprev = NULL;
+
+    /* Only a slot head can point into the wheel array */
+    if ((*pprev == NULL) && (pprev >= &wheel[0][0]) &&
+        (pprev <= &wheel[SWTIMER_LEVELS - 1U][SWTIMER_SLOTS - 1U])) {
+        uint32_t index = (uint32_t)(pprev - &wheel[0][0]);
+
+        wheel_occupied[index / SWTIMER_SLOTS] &= ~SWTIMER_SLOT_BIT(index & SWTIMER_SLOT_MASK);
+    }
+}
+
+/**
+ * @brief Earliest wheel time at which a slot expires or cascades
+ * @param when Receives that time
+ * @return 0 if no timer is running
+ */
+static uint32_t wheel_next(uint32_t* when) {
+    uint32_t found = 0;
+
+    for (uint32_t level = 0; level < SWTIMER_LEVELS; level++) {
+        uint32_t shift = SWTIMER_SLOT_BITS * level;
+        uint32_t above = ~((1UL << (shift + SWTIMER_SLOT_BITS)) - 1U);
+        uint32_t t;
+
+        if (wheel_occupied[level] == 0U) {
+            continue;
+        }
+        t = (wheel_now & above) | ((uint32_t)__CLZ(wheel_occupied[level]) << shift);
+        if (!found || ((int32_t)(t - *when) < 0)) {
+            *when = t;
+            found = 1;
+        }
+    }
+    return found;
+}
+
+/**
+ * @brief Handle wheel time t: cascade slots reached at t, then expire level 0
+ */
+static void wheel_run(uint32_t t) {
+    swtimer_t* timer;
+
+    for (uint32_t level = SWTIMER_LEVELS - 1U; level > 0U; level--) {
+        uint32_t shift = SWTIMER_SLOT_BITS * level;
+
+        if ((t & ((1UL << shift) - 1U)) == 0U) {
+            swtimer_t** head = &wheel[level][(t >> shift) & SWTIMER_SLOT_MASK];
+
+            while ((timer = *head) != NULL) {
+                wheel_remove(timer);
+                wheel_insert(timer);
+            }
+        }
+    }
+
+    while ((timer = wheel[0][t & SWTIMER_SLOT_MASK]) != NULL) {
+        wheel_remove(timer);
+
+        /* Re-arm before the callback, so it may stop or restart the timer */
+        if (timer->period != 0U) {
+            timer->expiry += timer->period;
+            if ((int32_t)(timer->expiry - wheel_now) <= 0) {
+                timer->expiry = wheel_now + timer->period;  /* Overrun: rephase */
+            }
+            wheel_insert(timer);
+        }
+        timer->callback(timer);
+    }
+}
+
+/**
+ * @brief Program channel 1 for the next event, or switch it off
+ */
+static void wheel_program(void) {
+    uint32_t next, delta;
+
+    if (!wheel_next(&next)) {
+        SWTIMER_TMR->iden = 0;
+        return;
+    }
+
+    delta = next - wheel_now;
+    if (delta > SWTIMER_MAX_SLEEP_MS) {
+        delta = SWTIMER_MAX_SLEEP_MS;
+    }
+    delta *= SWTIMER_COUNTS_PER_MS;
+
+    SWTIMER_TMR->c1dt = (wheel_count_ref + delta) & 0xFFFFU;
+    SWTIMER_TMR->iden = TMR_IDEN_C1IEN;
+
+    /* If the counter already passed the compare value, the match is a lap
+     * away - raise the channel event by software instead. */
+    if (((SWTIMER_TMR->cval - wheel_count_ref) & 0xFFFFU) >= delta) {
+        SWTIMER_TMR->swevt = TMR_SWEVT_C1SWTRIG;
+    }
+}
+
+/**
+ * @brief Start TMR3 as the wheel's time base (compare disabled until needed)
+ */
+void swtimer_init(void) {
+    (void)crm_periph_acquire(CRM_PERIPH_TMR3);
+
+    SWTIMER_TMR->ctrl1 = 0;
+    SWTIMER_TMR->div   = SWTIMER_PRESCALER;
+    SWTIMER_TMR->pr    = 0xFFFFU;
+    SWTIMER_TMR->cm1   = 0;                 /* Channel 1: compare only, no pin */
+    SWTIMER_TMR->cctrl = 0;
+    SWTIMER_TMR->iden  = 0;
+
+    /* Load the prescaler now, then drop the flags this produced */
+    SWTIMER_TMR->swevt = TMR_SWEVT_OVFGEN;
+    SWTIMER_TMR->ists  = 0;
+
+    SWTIMER_TMR->ctrl1 = TMR_CTRL1_CEN;
+
+    (void)crm_notify_register(swtimer_clock_notify);
+}
+
+/**
+ * @brief Start or restart a timer
+ */
+void swtimer_start(swtimer_t* timer, uint32_t delay_ms, uint32_t period_ms, swtimer_cb_t callback) {
+    swtimer_stop(timer);
+
+    /* An idle wheel has not tracked the counter - take it as the new base */
+    if (wheel_empty()) {
+        wheel_count_ref = SWTIMER_TMR->cval;
+    }
+
+    if (delay_ms == 0U) {
+        delay_ms = 1U;
+    }
+    if (delay_ms > SWTIMER_MAX_DELAY_MS - SWTIMER_MAX_SLEEP_MS) {
+        delay_ms = SWTIMER_MAX_DELAY_MS - SWTIMER_MAX_SLEEP_MS;
+    }
+
+    /* Expiry counts from real time; the slot is chosen against wheel time */
+    timer->expiry   = wheel_now + wheel_elapsed() + delay_ms;
+    timer->period   = period_ms;
+    timer->callback = callback;
+    wheel_insert(timer);
+    wheel_program();
+}
+
+/**
+ * @brief Stop a timer; harmless if it is not running
+ */
+void swtimer_stop(swtimer_t* timer) {
+    if (timer->pprev != NULL) {
+        wheel_remove(timer);
+        wheel_program();
+    }
+}
+
+/**
+ * @brief Wheel time in ms (advances only while timers are running)
+ */
+uint32_t swtimer_now(void) {
+    return wheel_empty() ? wheel_now : (wheel_now + wheel_elapsed());
+}
+
+/**
+ * @brief Milliseconds until the wheel next needs swtimer_process()
+ */
+uint32_t swtimer_next_ms(void) {
+    uint32_t next, now;
+
+    if (!wheel_next(&next)) {
+        return SWTIMER_NEXT_NONE;
+    }
+    now = wheel_now + wheel_elapsed();
+    return ((int32_t)(next - now) > 0) ? (next - now) : 0U;
+}
+
+/**
+ * @brief Account for time TMR3 was stopped (deep sleep)
+ */
+void swtimer_advance_us(uint32_t us) {
+    uint32_t counts;
+
+    us += advance_rem_us;
+    counts = us / SWTIMER_US_PER_COUNT;
+    advance_rem_us = us % SWTIMER_US_PER_COUNT;
+
+    SWTIMER_TMR->cval = (SWTIMER_TMR->cval + counts) & 0xFFFFU;
+    if (!wheel_empty()) {
+        wheel_program();
+    }
+}
+
+/**
+ * @brief Wakeup source check - confirms and clears the TMR3 compare flag
+ */
+uint32_t swtimer_check(void) {
+    if (SWTIMER_TMR->ists & TMR_ISTS_C1IF) {
+        SWTIMER_TMR->ists = ~TMR_ISTS_C1IF;
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Expire due timers and program the next compare
+ */
+void swtimer_process(void) {
+    uint32_t next;
+
+    if (wheel_empty()) {
+        SWTIMER_TMR->iden = 0;
+        return;
+    }
+
+    /* Visit only the times at which something happens; callbacks take
+     * time, so the real time is re-read on every pass. */
+    while (wheel_next(&next) && ((int32_t)(next - (wheel_now + wheel_elapsed())) <= 0)) {
+        wheel_advance(next);
+        wheel_run(next);
+    }
+
+    /* Nothing is due before the real time, so the wheel may catch up */
+    if (!wheel_empty()) {
+        wheel_advance(wheel_now + wheel_elapsed());
+    }
+    wheel_program();
+}
@@ -0,0 +1,155 @@
+/**
+ * Software Timers on a Hierarchical Timing Wheel
+ *
+ * Purpose: Run any number of one-shot and periodic software timers from a
+ *          single hardware timer, without a periodic tick
+ * Features: Millisecond resolution, callbacks in thread context,
+ *           drift-free periodic timers, delays up to SWTIMER_MAX_DELAY_MS
+ * Performance: O(1) start and stop (intrusive doubly linked lists, slot
+ *              found from the highest differing bit of expiry and now);
+ *              the next expiry is found with one CLZ per wheel level
+ * Usage: Call swtimer_init(), register the wakeup source, start timers
+ *
+ *   static swtimer_t blink;
+ *   static void on_blink(swtimer_t* t) { ... }
+ *
+ *   swtimer_init();
+ *   dispatch_register(2, SWTIMER_IRQn, swtimer_check, swtimer_process);
+ *   swtimer_start(&blink, 250, 500, on_blink);   // first after 250ms, then every 500ms
+ *
+ * Tickless Operation:
+ *   TMR3 free-runs at SWTIMER_COUNT_HZ. Instead of waking every
+ *   millisecond, channel 1 compare is programmed for the next expiry (or
+ *   the next wheel cascade), capped at SWTIMER_MAX_SLEEP_MS so the 16-bit
+ *   counter cannot lap unseen. With no timer running the compare is
+ *   disabled and TMR3 causes no wakeups at all. The compare only pends
+ *   TMR3's NVIC line, which wakes __WFE() through SEVONPEND - no ISR runs.
+ *
+ * Wheel Layout:
+ *   SWTIMER_LEVELS levels of 32 slots; level n slots are 32^n ms wide. A
+ *   timer sits at the level of the highest bit in which its expiry differs
+ *   from the current time, and cascades one level down when the wheel
+ *   reaches its slot.
+ *
+ * Note: TMR14 cannot carry the wheel - its only channel drives the PWM
+ *       output and its period is fixed by PWM_FREQUENCY_HZ.
+ */
+
+#ifndef SWTIMER_H
+#define SWTIMER_H
+
+#include "at32f421.h"
+#include "crm.h"
+
+/* Wheel depth: SWTIMER_LEVELS * 5 bits of millisecond time */
+#ifndef SWTIMER_LEVELS
+  #define SWTIMER_LEVELS              5U
+#endif
+
+#if (SWTIMER_LEVELS < 2U) || (SWTIMER_LEVELS > 6U)
+  #error "SWTIMER_LEVELS must be between 2 and 6"
+#endif
+
+/* Longest delay: keeps expiry and now within the wheel's bit range */
+#define SWTIMER_MAX_DELAY_MS        ((1UL << (5U * SWTIMER_LEVELS - 1U)) - 1U)
+
+/* Hardware counter: two counts per millisecond, 32.7s per 16-bit lap */
+#define SWTIMER_COUNT_HZ            2000U
+#define SWTIMER_COUNTS_PER_MS       (SWTIMER_COUNT_HZ / 1000U)
+#define SWTIMER_PRESCALER           ((TIMER_CLOCK_HZ / SWTIMER_COUNT_HZ) - 1U)
+
+/* Longest sleep between compare events - half a counter lap */
+#define SWTIMER_MAX_SLEEP_MS        16000U
+
+#if SWTIMER_PRESCALER > 65535U
+  #error "SWTIMER prescaler value exceeds 16-bit timer range"
+#endif
+
+#ifndef TMR3_GLOBAL_IRQn
+  #define TMR3_GLOBAL_IRQn            16
+#endif
+
+#define SWTIMER_TMR                 TMR3
+#define SWTIMER_IRQn                TMR3_GLOBAL_IRQn
+
+typedef struct swtimer swtimer_t;
+
+/**
+ * @brief Timer callback, called in thread context
+ */
+typedef void (*swtimer_cb_t)(swtimer_t* timer);
+
+/**
+ * @brief Software timer - storage belongs to the caller
+ */
+struct swtimer {
+    swtimer_t* next;                /*!< Slot list link */
+    swtimer_t** pprev;              /*!< Link pointing at this timer, NULL when stopped */
+    uint32_t expiry;                /*!< Wheel time of the next expiry */
+    uint32_t period;                /*!< Reload interval in ms, 0 = one-shot */
+    swtimer_cb_t callback;
+};
+
+/**
+ * @brief Start TMR3 as the wheel's time base (compare disabled until needed)
+ * @note Acquires the TMR3 clock itself (crm_periph_acquire)
+ */
+void swtimer_init(void);
+
+/**
+ * @brief Start or restart a timer
+ * @param timer    Timer storage
+ * @param delay_ms Time to the first expiry (0 is treated as 1), clamped to
+ *                 SWTIMER_MAX_DELAY_MS
+ * @param period_ms Reload interval, 0 for a one-shot timer
+ * @param callback Called on every expiry
+ */
+void swtimer_start(swtimer_t* timer, uint32_t delay_ms, uint32_t period_ms, swtimer_cb_t callback);
+
+/**
+ * @brief Stop a timer; harmless if it is not running
+ */
+void swtimer_stop(swtimer_t* timer);
+
+/**
+ * @brief Non-zero while the timer is running
+ */
+static inline uint32_t swtimer_active(const swtimer_t* timer) {
+    return timer->pprev != 0;
+}
+
+/**
+ * @brief Wheel time in ms (advances only while timers are running)
+ */
+uint32_t swtimer_now(void);
+
+/* swtimer_next_ms() result when no timer is running */
+#define SWTIMER_NEXT_NONE           0xFFFFFFFFU
+
+/**
+ * @brief Milliseconds until the wheel next needs swtimer_process()
+ * @return 0 if overdue, SWTIMER_NEXT_NONE if no timer is running
+ */
+uint32_t swtimer_next_ms(void);
+
+/**
+ * @brief Account for time TMR3 was stopped (deep sleep)
+ *
+ * Moves the counter forward and re-programs the compare; a deadline that
+ * was crossed is raised at once. Fractions of a count are carried over.
+ * @param us Time the counter missed; the total since the last
+ *           swtimer_process() must stay below SWTIMER_MAX_SLEEP_MS
+ */
+void swtimer_advance_us(uint32_t us);
+
+/**
+ * @brief Wakeup source check - confirms and clears the TMR3 compare flag
+ */
+uint32_t swtimer_check(void);
+
+/**
+ * @brief Expire due timers and program the next compare
+ */
+void swtimer_process(void);
+
+#endif /* SWTIMER_H */
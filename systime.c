@@ -0,0 +1,96 @@
+/**
+ * Monotonic Microsecond Clock Implementation
+ */
+
+#include "systime.h"
+#include "timer.h"
+#include "ramfunc.h"
+
+/* Number of completed 65536us laps, advanced by the overflow interrupt */
+static volatile uint32_t time_laps = 0;
+
+/**
+ * @brief Keep counting microseconds across system clock changes
+ */
+static void time_clock_notify(crm_clock_event_t event) {
+    if (event == CRM_CLOCK_POST_CHANGE) {
+        tmr_div_set_now(SYSTIME_TMR, crm_get_clocks()->tmr_hz / 1000000U - 1U);
+    }
+}
+
+/**
+ * @brief Start the microsecond counter and its overflow interrupt
+ */
+void time_init(void) {
+    (void)crm_periph_acquire(CRM_PERIPH_TMR6);
+
+    SYSTIME_TMR->ctrl1 = 0;
+    SYSTIME_TMR->div   = SYSTIME_PRESCALER;
+    SYSTIME_TMR->pr    = 0xFFFFU;
+
+    /* Load the prescaler now, then drop the flag this produced */
+    SYSTIME_TMR->swevt = TMR_SWEVT_OVFGEN;
+    SYSTIME_TMR->ists  = 0;
+    SYSTIME_TMR->iden  = TMR_IDEN_UIEN;
+
+    NVIC_ClearPendingIRQ(SYSTIME_IRQn);
+    NVIC_EnableIRQ(SYSTIME_IRQn);
+
+    SYSTIME_TMR->ctrl1 = TMR_CTRL1_CEN;
+
+    (void)crm_notify_register(time_clock_notify);
+}
+
+/**
+ * @brief TMR6 overflow - one more lap
+ */
+RAMFUNC void TMR6_GLOBAL_IRQHandler(void) {
+    if (SYSTIME_TMR->ists & TMR_ISTS_OVFIF) {
+        SYSTIME_TMR->ists = ~TMR_ISTS_OVFIF;
+        time_laps++;
+    }
+}
+
+/**
+ * @brief Account for time TMR6 was stopped (deep sleep)
+ */
+void time_advance_us(uint32_t us) {
+    uint32_t primask = __get_PRIMASK();
+    uint32_t count;
+
+    __disable_irq();
+
+    /* Keep clear of a hardware wrap between the read and the write, which
+     * would count the lap twice - at most 16us of waiting */
+    do {
+        count = SYSTIME_TMR->cval;
+    } while (count >= 0xFFF0U);
+
+    count += us & 0xFFFFU;
+    SYSTIME_TMR->cval = count & 0xFFFFU;
+    time_laps += (us >> 16) + (count >> 16);
+
+    __set_PRIMASK(primask);
+}
+
+/**
+ * @brief Microseconds since time_init() - callable from any context
+ */
+uint64_t time_now_us(void) {
+    uint32_t laps, count, pending;
+
+    /* Retry if the overflow handler ran between the reads */
+    do {
+        laps    = time_laps;
+        count   = SYSTIME_TMR->cval;
+        pending = SYSTIME_TMR->ists & TMR_ISTS_OVFIF;
+    } while (laps != time_laps);
+
+    /* An overflow that is flagged but not yet counted belongs to this
+     * reading if the counter has already wrapped (small value). A large
+     * value means the counter was read just before the wrap. */
+    if (pending && (count < 0x8000U)) {
+        laps++;
+    }
+    return ((uint64_t)laps << 16) | count;
+}
@@ -0,0 +1,217 @@
+/**
+ * Mock AT32F421 Device Header for Host Tests
+ *
+ * Purpose: Stand-in for the vendor at32f421.h so driver sources compile
+ *          natively. Register blocks are plain structs behind pointers
+ *          that each test defines and points at its own instances; the
+ *          CMSIS intrinsics are declared here and implemented by the test
+ *          for the ones the code under test calls.
+ *
+ * Note: Only the types, IRQ numbers and core masks the project uses are
+ *       provided. Peripheral field masks come from the driver headers as
+ *       on the target. Drivers store buffer addresses in 32-bit DMA
+ *       registers, so tests link with -no-pie to keep static data below
+ *       4GB.
+ */
+
+#ifndef AT32F421_H
+#define AT32F421_H
+
+#include <stdint.h>
+
+#define __IO                        volatile
+#define __I                         volatile const
+#define __STATIC_INLINE             static inline
+#define __STATIC_FORCEINLINE        static inline __attribute__((always_inline))
+#define __ALIGNED(x)                __attribute__((aligned(x)))
+#define __WEAK                      __attribute__((weak))
+
+typedef enum {
+    NonMaskableInt_IRQn         = -14,
+    HardFault_IRQn              = -13,
+    MemoryManagement_IRQn       = -12,
+    BusFault_IRQn               = -11,
+    UsageFault_IRQn             = -10,
+    SVCall_IRQn                 = -5,
+    DebugMonitor_IRQn           = -4,
+    PendSV_IRQn                 = -2,
+    SysTick_IRQn                = -1,
+    WWDT_IRQn                   = 0,
+    PVM_IRQn                    = 1,
+    ERTC_IRQn                   = 2,
+    FLASH_IRQn                  = 3,
+    CRM_IRQn                    = 4,
+    EXINT1_0_IRQn               = 5,
+    EXINT3_2_IRQn               = 6,
+    EXINT15_4_IRQn              = 7,
+    DMA1_Channel1_IRQn          = 9,
+    DMA1_Channel3_2_IRQn        = 10,
+    DMA1_Channel5_4_IRQn        = 11,
+    ADC1_CMP_IRQn               = 12,
+    TMR1_BRK_OVF_TRG_HALL_IRQn  = 13,
+    TMR1_CH_IRQn                = 14,
+    TMR3_GLOBAL_IRQn            = 16,
+    TMR6_GLOBAL_IRQn            = 17,
+    TMR14_GLOBAL_IRQn           = 19,
+    TMR15_GLOBAL_IRQn           = 20,
+    TMR16_GLOBAL_IRQn           = 21,
+    TMR17_GLOBAL_IRQn           = 22,
+    I2C1_EVT_IRQn               = 23,
+    I2C2_EVT_IRQn               = 24,
+    SPI1_IRQn                   = 25,
+    SPI2_IRQn                   = 26,
+    USART1_IRQn                 = 27,
+    USART2_IRQn                 = 28,
+    I2C1_ERR_IRQn               = 30,
+    I2C2_ERR_IRQn               = 32
+} IRQn_Type;
+
+/* Peripheral register blocks, in vendor field order */
+typedef struct {
+    __IO uint32_t ctrl, cfg, clkint, apb2rst, apb1rst, ahben, apb2en, apb1en;
+    __IO uint32_t bpdc, ctrlsts, ahbrst, pll, misc1, reserved[4], misc2;
+} crm_type;
+
+typedef struct {
+    __IO uint32_t psr, unlock, usd_unlock, sts, ctrl, addr, reserved, usd, epps;
+    __IO uint32_t reserved2[20], slib_sts0;
+} flash_type;
+
+typedef struct {
+    __IO uint32_t ctrl1, ctrl2, stctrl, iden, ists, swevt, cm1, cm2, cctrl, cval;
+    __IO uint32_t div, pr, rpr, c1dt, c2dt, c3dt, c4dt, brk, dmactrl, dmadt;
+} tmr_type;
+
+typedef struct {
+    __IO uint32_t sts, dt, baudr, ctrl1, ctrl2, ctrl3, gdiv;
+} usart_type;
+
+typedef struct {
+    __IO uint32_t cfgr, omode, odrvr, pull, idt, odt, scr, wpr, muxl, muxh, clr;
+    __IO uint32_t reserved[4], hdrv;
+} gpio_type;
+
+typedef struct {
+    __IO uint32_t sts, clr;
+} dma_type;
+
+typedef struct {
+    __IO uint32_t ctrl, dtcnt, paddr, maddr;
+} dma_channel_type;
+
+typedef struct {
+    __IO uint32_t ctrl, ctrlsts;
+} pwc_type;
+
+typedef struct {
+    __IO uint32_t inten, evten, polcfg1, polcfg2, swtrg, intsts;
+} exint_type;
+
+typedef struct {
+    __IO uint32_t time, date, ctrl, sts, div, wat, ccal, ala, alb, wp, sbs, tadj;
+    __IO uint32_t tstm, tstd, tssbs, scal, tamp, alasbs, albsbs, reserved, bpr[5];
+} ertc_type;
+
+typedef struct {
+    __IO uint32_t cfg1, cfg2, exintc[4], cfg3;
+} scfg_type;
+
+typedef struct {
+    __IO uint32_t idcode, ctrl;
+} debug_type;
+
+extern crm_type* CRM;
+extern flash_type* FLASH;
+extern tmr_type *TMR1, *TMR3, *TMR6, *TMR14, *TMR15, *TMR16, *TMR17;
+extern usart_type* USART1;
+extern gpio_type *GPIOA, *GPIOB, *GPIOF;
+extern dma_type* DMA1;
+extern dma_channel_type *DMA1_CHANNEL1, *DMA1_CHANNEL2, *DMA1_CHANNEL3;
+extern dma_channel_type *DMA1_CHANNEL4, *DMA1_CHANNEL5;
+extern pwc_type* PWC;
+extern exint_type* EXINT;
+extern ertc_type* ERTC;
+extern scfg_type* SCFG;
+extern debug_type* DEBUGMCU;
+
+/* Core peripherals */
+typedef struct {
+    __I  uint32_t CPUID;
+    __IO uint32_t ICSR, VTOR, AIRCR, SCR, CCR;
+    __IO uint8_t  SHP[12];
+    __IO uint32_t SHCSR, CFSR, HFSR, DFSR, MMFAR, BFAR, AFSR;
+} SCB_Type;
+
+typedef struct {
+    __IO uint32_t CTRL, LOAD, VAL;
+    __I  uint32_t CALIB;
+} SysTick_Type;
+
+typedef struct {
+    __IO uint32_t ISER[8], reserved0[24], ICER[8], reserved1[24];
+    __IO uint32_t ISPR[8], reserved2[24], ICPR[8], reserved3[24];
+    __IO uint32_t IABR[8], reserved4[56];
+    __IO uint8_t  IP[240];
+} NVIC_Type;
+
+typedef struct {
+    __IO uint32_t CTRL, CYCCNT, CPICNT, EXCCNT, SLEEPCNT, LSUCNT, FOLDCNT;
+    __I  uint32_t PCSR;
+} DWT_Type;
+
+typedef struct {
+    __IO uint32_t DHCSR, DCRSR, DCRDR, DEMCR;
+} CoreDebug_Type;
+
+extern SCB_Type* SCB;
+extern SysTick_Type* SysTick;
+extern NVIC_Type* NVIC;
+extern DWT_Type* DWT;
+extern CoreDebug_Type* CoreDebug;
+
+#define SCB_SCR_SEVONPEND_Msk       (1UL << 4)
+#define SCB_SCR_SLEEPDEEP_Msk       (1UL << 2)
+#define SCB_SCR_SLEEPONEXIT_Msk     (1UL << 1)
+#define SCB_ICSR_NMIPENDSET_Msk     (1UL << 31)
+#define SysTick_CTRL_ENABLE_Msk     (1UL << 0)
+#define SysTick_CTRL_TICKINT_Msk    (1UL << 1)
+#define SysTick_CTRL_CLKSOURCE_Msk  (1UL << 2)
+#define SysTick_CTRL_COUNTFLAG_Msk  (1UL << 16)
+#define DWT_CTRL_CYCCNTENA_Msk      (1UL << 0)
+#define DWT_CTRL_NOCYCCNT_Msk       (1UL << 25)
+#define CoreDebug_DEMCR_TRCENA_Msk  (1UL << 24)
+
+/* CMSIS intrinsics and NVIC access */
+void __WFE(void);
+void __WFI(void);
+void __SEV(void);
+void __NOP(void);
+void __DSB(void);
+void __ISB(void);
+void __DMB(void);
+void __disable_irq(void);
+void __enable_irq(void);
+uint32_t __get_PRIMASK(void);
+void __set_PRIMASK(uint32_t primask);
+uint32_t __LDREXW(volatile uint32_t* addr);
+uint32_t __STREXW(uint32_t value, volatile uint32_t* addr);
+uint8_t __LDREXB(volatile uint8_t* addr);
+uint32_t __STREXB(uint8_t value, volatile uint8_t* addr);
+void __CLREX(void);
+uint8_t __CLZ(uint32_t value);
+uint32_t __RBIT(uint32_t value);
+uint32_t __get_MSP(void);
+void __set_MSP(uint32_t msp);
+
+void NVIC_EnableIRQ(IRQn_Type irqn);
+void NVIC_DisableIRQ(IRQn_Type irqn);
+void NVIC_ClearPendingIRQ(IRQn_Type irqn);
+void NVIC_SetPendingIRQ(IRQn_Type irqn);
+uint32_t NVIC_GetPendingIRQ(IRQn_Type irqn);
+void NVIC_SetPriority(IRQn_Type irqn, uint32_t priority);
+
+extern uint32_t system_core_clock;
+#define SystemCoreClock             system_core_clock
+void SystemInit(void);
+
+#endif /* AT32F421_H */
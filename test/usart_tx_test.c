@@ -0,0 +1,423 @@
+/**
+ * Host Test: USART1 Transmit Path Under Burst Load
+ *
+ * Purpose: Show that usart.c neither loses nor reorders a byte it has
+ *          accepted, whichever overflow policy and drain mode it is built
+ *          with, while writers keep the ring and segment queue full
+ * Features: usart.c runs unchanged against mocked USART1/DMA1 registers
+ *           (test/mock/at32f421.h). A periodic SIGALRM plays interrupt
+ *           context: it interrupts the writer at arbitrary points, moves a
+ *           random number of bytes out of the "hardware" and raises the
+ *           interrupt the driver asked for. __disable_irq() blocks the
+ *           signal, so masked sections behave as on the target.
+ *           - USART_TX_DMA=1: the DMA channel 2 model latches maddr/dtcnt,
+ *             drains the segment and raises the transfer complete flag
+ *           - USART_TX_DMA=0: TDBE is presented while TDBEIEN is set and
+ *             every byte written to DT is captured
+ * Usage: make test (builds and runs every policy/mode combination)
+ *
+ * Checks:
+ *   • The captured stream equals the bytes each call reported as queued,
+ *     in call order - usart_write()/usart_write_dma() return values,
+ *     usart_tx_dropped() deltas for the void writers
+ *   • usart_tx_dropped() matches the bytes the returning writers refused,
+ *     and USART_TX_OVERFLOW_BLOCK drops none
+ *   • The completion interrupt clears the flag it handles
+ */
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "usart.h"
+#include "event.h"
+
+#ifndef TEST_ROUNDS
+  #define TEST_ROUNDS                 5000U
+#endif
+
+#define TEST_POOL_SIZE              4096U
+#define TEST_STREAM_MAX             (1024U * 1024U)
+#define TEST_TICK_US                20
+#define TEST_TIMEOUT_S              20
+#define TEST_DT_IDLE                0xFFFFFFFFU
+
+/*******************************************************************************
+ * Mocked device
+ ******************************************************************************/
+
+static usart_type usart1_regs;
+static dma_type dma1_regs;
+static dma_channel_type dma1_channel_regs[5];
+static tmr_type tmr1_regs;
+static gpio_type gpioa_regs;
+static DWT_Type dwt_regs;
+
+usart_type* USART1 = &usart1_regs;
+dma_type* DMA1 = &dma1_regs;
+dma_channel_type* DMA1_CHANNEL2 = &dma1_channel_regs[1];
+dma_channel_type* DMA1_CHANNEL3 = &dma1_channel_regs[2];
+tmr_type* TMR1 = &tmr1_regs;
+gpio_type* GPIOA = &gpioa_regs;
+DWT_Type* DWT = &dwt_regs;
+
+/* Vector table entries of the code under test */
+void DMA1_Channel3_2_IRQHandler(void);
+void USART1_IRQHandler(void);
+
+/* PRIMASK is modelled by blocking SIGALRM */
+static sigset_t irq_signal;
+
+void __disable_irq(void) {
+    sigprocmask(SIG_BLOCK, &irq_signal, NULL);
+}
+
+uint32_t __get_PRIMASK(void) {
+    sigset_t current;
+
+    sigprocmask(SIG_BLOCK, NULL, &current);
+    return (uint32_t)sigismember(&current, SIGALRM);
+}
+
+void __set_PRIMASK(uint32_t primask) {
+    sigprocmask(primask ? SIG_BLOCK : SIG_UNBLOCK, &irq_signal, NULL);
+}
+
+void NVIC_EnableIRQ(IRQn_Type irqn) {
+    (void)irqn;
+}
+
+void NVIC_DisableIRQ(IRQn_Type irqn) {
+    (void)irqn;
+}
+
+void NVIC_ClearPendingIRQ(IRQn_Type irqn) {
+    (void)irqn;
+}
+
+/*******************************************************************************
+ * Stubbed collaborators
+ ******************************************************************************/
+
+static volatile uint32_t tx_done_events;
+
+uint32_t event_post(event_type_t type, uint32_t data) {
+    (void)data;
+    if (type == EVENT_TX_DONE) {
+        tx_done_events++;
+    }
+    return 1U;
+}
+
+crm_status_t crm_periph_acquire(crm_periph_t periph) {
+    (void)periph;
+    return CRM_OK;
+}
+
+crm_status_t crm_periph_release(crm_periph_t periph) {
+    (void)periph;
+    return CRM_OK;
+}
+
+crm_status_t crm_notify_register(crm_notify_t notify) {
+    (void)notify;
+    return CRM_OK;
+}
+
+const crm_clocks_t* crm_get_clocks(void) {
+    static crm_clocks_t clocks;
+    return &clocks;
+}
+
+void tlog_printf(const char* fmt, const uint32_t* argv, uint32_t argc) {
+    (void)fmt;
+    (void)argv;
+    (void)argc;
+}
+
+/*******************************************************************************
+ * Wire and expectation
+ ******************************************************************************/
+
+static uint8_t wire[TEST_STREAM_MAX];
+static volatile uint32_t wire_len;
+static uint8_t expected[TEST_STREAM_MAX];
+static uint32_t expected_len;
+static uint32_t expected_dropped;
+static volatile uint32_t irq_faults;
+
+/* Caller-owned source for usart_write_dma(); never modified, so every
+ * slice stays valid until the DMA has read it */
+static uint8_t pool[TEST_POOL_SIZE];
+
+/**
+ * @brief xorshift32 - deterministic, so a failing run repeats its writes
+ */
+static uint32_t rng_step(uint32_t* state) {
+    uint32_t x = *state;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+/**
+ * @brief Append bytes the mocked hardware shifted out (interrupt context)
+ */
+static void wire_put(const uint8_t* data, uint32_t len) {
+    if (wire_len + len > TEST_STREAM_MAX) {
+        irq_faults++;
+        return;
+    }
+    memcpy(&wire[wire_len], data, len);
+    wire_len += len;
+}
+
+/**
+ * @brief Append bytes the driver reported as queued (writer context)
+ */
+static void expect(const void* data, uint32_t len) {
+    if (expected_len + len <= TEST_STREAM_MAX) {
+        memcpy(&expected[expected_len], data, len);
+    }
+    expected_len += len;
+}
+
+/*******************************************************************************
+ * Interrupt context
+ ******************************************************************************/
+
+static uint32_t irq_rng = 0x2545F491U;
+
+#if USART_TX_DMA
+
+static const uint8_t* dma_src;
+static uint32_t dma_left;
+
+/**
+ * @brief Advance the channel 2 transfer, completing it when dtcnt runs out
+ */
+static void hw_step(void) {
+    uint32_t n;
+
+    if (dma_left == 0U) {
+        /* Idle: pick up a transfer the driver has programmed and enabled */
+        if (!(USART_TX_DMA_CHANNEL->ctrl & DMA_CTRL_CHEN) ||
+            (USART_TX_DMA_CHANNEL->dtcnt == 0U)) {
+            return;
+        }
+        dma_src  = (const uint8_t*)(uintptr_t)USART_TX_DMA_CHANNEL->maddr;
+        dma_left = USART_TX_DMA_CHANNEL->dtcnt;
+    }
+
+    n = 1U + rng_step(&irq_rng) % 32U;
+    if (n > dma_left) {
+        n = dma_left;
+    }
+    wire_put(dma_src, n);
+    dma_src  += n;
+    dma_left -= n;
+    USART_TX_DMA_CHANNEL->dtcnt = dma_left;
+
+    if (dma_left == 0U) {
+        DMA1->sts |= DMA_STS_GF2 | DMA_STS_FDTF2;
+        if (USART_TX_DMA_CHANNEL->ctrl & DMA_CTRL_FDTIEN) {
+            DMA1->clr = 0;
+            DMA1_Channel3_2_IRQHandler();
+            if (!(DMA1->clr & DMA_STS_FDTF2)) {
+                irq_faults++;
+            }
+            DMA1->sts &= ~DMA1->clr;
+        }
+    }
+}
+
+#else /* !USART_TX_DMA */
+
+/**
+ * @brief Present TDBE a few times and capture what the handler writes to DT
+ */
+static void hw_step(void) {
+    uint32_t n = 1U + rng_step(&irq_rng) % 8U;
+
+    while (n-- && (USART1->ctrl1 & USART_CTRL1_TDBEIEN)) {
+        USART1->dt = TEST_DT_IDLE;
+        USART1->sts |= USART_STS_TDBE;
+        USART1_IRQHandler();
+        if (USART1->dt != TEST_DT_IDLE) {
+            uint8_t byte = (uint8_t)USART1->dt;
+            wire_put(&byte, 1U);
+        }
+    }
+}
+
+#endif /* USART_TX_DMA */
+
+/**
+ * @brief SIGALRM handler - one slice of hardware progress and interrupts
+ */
+static void irq_tick(int sig) {
+    (void)sig;
+    hw_step();
+}
+
+/**
+ * @brief SIGPROF handler - a writer that never gets its space back spins
+ *        forever, so running out of CPU time is a failure too
+ */
+static void watchdog(int sig) {
+    static const char msg[] = "FAIL: timed out waiting for the transmitter\n";
+
+    (void)sig;
+    (void)write(STDOUT_FILENO, msg, sizeof(msg) - 1U);
+    _exit(1);
+}
+
+/*******************************************************************************
+ * Writers
+ ******************************************************************************/
+
+/**
+ * @brief Record what a void writer queued, from the dropped-byte counter
+ * @param data    Bytes passed to the writer
+ * @param len     Number of bytes passed
+ * @param dropped usart_tx_dropped() before the call
+ */
+static void expect_unless_dropped(const void* data, uint32_t len, uint32_t dropped) {
+    uint32_t lost = usart_tx_dropped() - dropped;
+
+    /* Drop discards all of a write, truncate the tail of it */
+    expect(data, len - lost);
+    expected_dropped += lost;
+}
+
+/**
+ * @brief Random mix of every transmit entry point, faster than the drain
+ * @param rounds Number of calls
+ */
+static void burst(uint32_t rounds) {
+    uint32_t rng = 0x9E3779B9U;
+    uint32_t i;
+
+    for (i = 0; i < rounds; i++) {
+        uint32_t r = rng_step(&rng);
+        uint32_t offset = (r >> 8) % (TEST_POOL_SIZE / 2U);
+        uint32_t dropped = usart_tx_dropped();
+        char text[16];
+        uint32_t len;
+        uint32_t queued;
+
+        switch (r % 6U) {
+        case 0:
+            /* Up to twice the ring, so writes wrap and overflow */
+            len = 1U + (r >> 20) % (2U * USART_TX_BUFFER_SIZE);
+            queued = usart_write(&pool[offset], len);
+            expect(&pool[offset], queued);
+            expected_dropped += len - queued;
+            break;
+        case 1:
+            len = 1U + (r >> 20) % (2U * USART_TX_BUFFER_SIZE);
+            queued = (uint32_t)usart_write_dma(&pool[offset], len);
+            expect(&pool[offset], queued);
+            expected_dropped += len - queued;
+            break;
+        case 2:
+            usart_putchar((char)pool[offset]);
+            expect_unless_dropped(&pool[offset], 1U, dropped);
+            break;
+        case 3:
+            len = (uint32_t)snprintf(text, sizeof(text), "%u", r);
+            usart_put_uint(r);
+            expect_unless_dropped(text, len, dropped);
+            break;
+        case 4:
+            len = (uint32_t)snprintf(text, sizeof(text), "<%u>", i);
+            usart_puts(text);
+            expect_unless_dropped(text, len, dropped);
+            break;
+        default:
+            /* Let the queue drain now and then, so that the drop and
+             * truncate policies see a mix of full and empty states */
+            if ((r >> 16) % 8U == 0U) {
+                usart_flush();
+            }
+            break;
+        }
+    }
+}
+
+/*******************************************************************************
+ * Main
+ ******************************************************************************/
+
+int main(void) {
+    struct sigaction action;
+    struct itimerval tick = { { 0, TEST_TICK_US }, { 0, TEST_TICK_US } };
+    struct itimerval timeout = { { 0, 0 }, { TEST_TIMEOUT_S, 0 } };
+    uint32_t i;
+    int failed = 0;
+
+    if ((uintptr_t)&pool[TEST_POOL_SIZE - 1U] > UINT32_MAX) {
+        printf("FAIL: static data above 4GB, link with -no-pie\n");
+        return 1;
+    }
+    for (i = 0; i < TEST_POOL_SIZE; i++) {
+        pool[i] = (uint8_t)(i * 7U + (i >> 8));
+    }
+
+    sigemptyset(&irq_signal);
+    sigaddset(&irq_signal, SIGALRM);
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = irq_tick;
+    sigaction(SIGALRM, &action, NULL);
+    action.sa_handler = watchdog;
+    sigaction(SIGPROF, &action, NULL);
+    setitimer(ITIMER_PROF, &timeout, NULL);
+
+    USART1->sts = USART_STS_TDBE | USART_STS_TDC;
+    usart_config();
+    setitimer(ITIMER_REAL, &tick, NULL);
+
+    burst(TEST_ROUNDS);
+    usart_flush();
+
+    __disable_irq();
+
+    if (expected_len > TEST_STREAM_MAX) {
+        printf("FAIL: %u bytes queued, stream buffer holds %u\n", expected_len, TEST_STREAM_MAX);
+        failed = 1;
+    } else if (wire_len != expected_len) {
+        printf("FAIL: %u bytes on the wire, %u queued\n", wire_len, expected_len);
+        failed = 1;
+    } else if (memcmp(wire, expected, expected_len) != 0) {
+        for (i = 0; wire[i] == expected[i]; i++) {
+        }
+        printf("FAIL: stream differs at byte %u of %u\n", i, expected_len);
+        failed = 1;
+    }
+    if (usart_tx_dropped() != expected_dropped) {
+        printf("FAIL: %u bytes dropped, %u refused\n", usart_tx_dropped(), expected_dropped);
+        failed = 1;
+    }
+#if USART_TX_OVERFLOW_POLICY == USART_TX_OVERFLOW_BLOCK
+    if (usart_tx_dropped() != 0U) {
+        printf("FAIL: %u bytes dropped with the block policy\n", usart_tx_dropped());
+        failed = 1;
+    }
+#endif
+    if (irq_faults != 0U) {
+        printf("FAIL: %u interrupt faults\n", irq_faults);
+        failed = 1;
+    }
+
+    printf("%s: dma=%u policy=%u, %u bytes sent, %u dropped, %u drain events\n",
+           failed ? "FAIL" : "PASS", (uint32_t)USART_TX_DMA,
+           (uint32_t)USART_TX_OVERFLOW_POLICY, wire_len, usart_tx_dropped(),
+           tx_done_events);
+    return failed;
+}
@@ -8,6 +8,22 @@
 
 #include "timer.h"
 
+#define LOG_MODULE_NAME  "timer"
+#define LOG_MODULE_LEVEL LOG_LEVEL_TIMER
+#include "log.h"
+
+/* Part of a count not yet applied by timer_advance_us() */
+static uint32_t advance_rem_us = 0;
+
+/**
+ * @brief Keep the 10kHz count rate across system clock changes
+ */
+static void timer_clock_notify(crm_clock_event_t event) {
+    if (event == CRM_CLOCK_POST_CHANGE) {
+        tmr_div_set_now(TMR14, crm_get_clocks()->tmr_hz / PWM_TIMER_FREQ_HZ - 1U);
+    }
+}
+
 /**
  * @brief Configure TMR14 for PWM generation using force update event
  * 
@@ -16,6 +32,8 @@
  * based on system frequency from crm.h.
  */
 void timer_config(void) {
+    (void)crm_periph_acquire(CRM_PERIPH_TMR14);
+
     /* Set prescaler - automatically calculated from TIMER_CLOCK_HZ */
     TMR14->div = PWM_PRESCALER;
 
@@ -42,4 +60,31 @@ void timer_config(void) {
 
     /* Start timer */
     TMR14->ctrl1 = TMR_CTRL1_CEN;
+
+    (void)crm_notify_register(timer_clock_notify);
+}
+
+/**
+ * @brief Microseconds until the next TMR14 overflow (scheduler tick)
+ */
+uint32_t timer_next_tick_us(void) {
+    return (PWM_PERIOD + 1U - TMR14->cval) * PWM_US_PER_COUNT;
+}
+
+/**
+ * @brief Account for time TMR14 was stopped (deep sleep)
+ */
+void timer_advance_us(uint32_t us) {
+    uint32_t count;
+
+    us += advance_rem_us;
+    advance_rem_us = us % PWM_US_PER_COUNT;
+
+    count = TMR14->cval + us / PWM_US_PER_COUNT;
+    if (count > PWM_PERIOD) {
+        /* The sleep overran the tick; it fires on the next count instead */
+        LOG_WARN("Tick late by %uus after sleep", (count - PWM_PERIOD) * PWM_US_PER_COUNT);
+        count = PWM_PERIOD;
+    }
+    TMR14->cval = count;
 }
@@ -11,7 +11,7 @@
  * - Active-low polarity PWM output
  * - Immediate register updates via force update event
  * - Update interrupt for WFE event generation
- * - Automatic clock frequency adjustment (120MHz/125MHz)
+ * - Prescaler follows the crm.h clock table (120MHz, 100MHz with a 25MHz HEXT)
  * 
  * All bit definitions follow CMSIS style for consistency.
  */
@@ -45,6 +45,9 @@
 #define PWM_PERIOD_COUNTS           (PWM_TIMER_FREQ_HZ / PWM_FREQUENCY_HZ)
 #define PWM_PERIOD                  (PWM_PERIOD_COUNTS - 1U)
 
+/* Duration of one timer count */
+#define PWM_US_PER_COUNT            (1000000U / PWM_TIMER_FREQ_HZ)
+
 /* PWM compare value for duty cycle */
 #define PWM_COMPARE                 (PWM_PERIOD_COUNTS * PWM_DUTY_RATIO / 100U)
 
@@ -73,6 +76,9 @@
 #define TMR_SWEVT_OVFGEN_Pos        (0U)
 #define TMR_SWEVT_OVFGEN_Msk        (0x1U << TMR_SWEVT_OVFGEN_Pos)
 #define TMR_SWEVT_OVFGEN            TMR_SWEVT_OVFGEN_Msk
+#define TMR_SWEVT_C1SWTRIG_Pos      (1U)
+#define TMR_SWEVT_C1SWTRIG_Msk      (0x1U << TMR_SWEVT_C1SWTRIG_Pos)
+#define TMR_SWEVT_C1SWTRIG          TMR_SWEVT_C1SWTRIG_Msk
 
 /* TMR14->ists (Interrupt Status Register) */
 #define TMR_ISTS_OVFIF_Pos          (0U)
@@ -103,6 +109,74 @@
 #define TMR_CM1_OC1M_Msk            (0x7U << TMR_CM1_OC1M_Pos)
 #define TMR_CM1_OC1M_PWM1           (0x6U << TMR_CM1_OC1M_Pos)
 
+/*******************************************************************************
+ * Input Capture Bit Definitions (TMR1 CH3/CH4, used by USART autobaud)
+ ******************************************************************************/
+
+/* TMRx->cm2 (Capture/Compare Mode Register 2, input mode) */
+#define TMR_CM2_C3C_Pos             (0U)
+#define TMR_CM2_C3C_Msk             (0x3U << TMR_CM2_C3C_Pos)
+#define TMR_CM2_C3C_DIRECT          (0x1U << TMR_CM2_C3C_Pos)    /* C3IN = TI3 */
+#define TMR_CM2_C3DF_Pos            (4U)
+#define TMR_CM2_C3DF_Msk            (0xFU << TMR_CM2_C3DF_Pos)
+#define TMR_CM2_C4C_Pos             (8U)
+#define TMR_CM2_C4C_Msk             (0x3U << TMR_CM2_C4C_Pos)
+#define TMR_CM2_C4C_INDIRECT        (0x2U << TMR_CM2_C4C_Pos)    /* C4IN = TI3 */
+
+/* TMRx->cctrl (Channel Control Register) */
+#define TMR_CCTRL_C3EN_Pos          (8U)
+#define TMR_CCTRL_C3EN_Msk          (0x1U << TMR_CCTRL_C3EN_Pos)
+#define TMR_CCTRL_C3EN              TMR_CCTRL_C3EN_Msk
+#define TMR_CCTRL_C3P_Pos           (9U)
+#define TMR_CCTRL_C3P_Msk           (0x1U << TMR_CCTRL_C3P_Pos)
+#define TMR_CCTRL_C3P               TMR_CCTRL_C3P_Msk           /* Falling edge */
+#define TMR_CCTRL_C4EN_Pos          (12U)
+#define TMR_CCTRL_C4EN_Msk          (0x1U << TMR_CCTRL_C4EN_Pos)
+#define TMR_CCTRL_C4EN              TMR_CCTRL_C4EN_Msk
+
+/* TMRx->ists / TMRx->iden channel flags */
+#define TMR_ISTS_C1IF_Pos           (1U)
+#define TMR_ISTS_C1IF               (0x1U << TMR_ISTS_C1IF_Pos)
+#define TMR_ISTS_C3IF_Pos           (3U)
+#define TMR_ISTS_C3IF               (0x1U << TMR_ISTS_C3IF_Pos)
+#define TMR_ISTS_C4IF_Pos           (4U)
+#define TMR_ISTS_C4IF               (0x1U << TMR_ISTS_C4IF_Pos)
+#define TMR_ISTS_C4RF_Pos           (12U)
+#define TMR_ISTS_C4RF               (0x1U << TMR_ISTS_C4RF_Pos)  /* C4 recapture */
+
+#define TMR_IDEN_C1IEN_Pos          (1U)
+#define TMR_IDEN_C1IEN              (0x1U << TMR_IDEN_C1IEN_Pos)
+#define TMR_IDEN_C4IEN_Pos          (4U)
+#define TMR_IDEN_C4IEN              (0x1U << TMR_IDEN_C4IEN_Pos)
+
+/*******************************************************************************
+ * Shared Helpers
+ ******************************************************************************/
+
+/**
+ * @brief Change a running timer's prescaler at once, keeping its count
+ *
+ * The prescaler is buffered until the next overflow, so the change is
+ * forced with a software overflow event and the count written back. The
+ * overflow flag this raises is dropped; one that was already pending stays.
+ * Used by the clock change notifiers of TMR3, TMR6 and TMR14.
+ */
+static inline void tmr_div_set_now(tmr_type* tmr, uint32_t div) {
+    uint32_t primask = __get_PRIMASK();
+    uint32_t count, pending;
+
+    __disable_irq();
+    count   = tmr->cval;
+    pending = tmr->ists & TMR_ISTS_OVFIF;
+    tmr->div   = div;
+    tmr->swevt = TMR_SWEVT_OVFGEN;
+    tmr->cval  = count;
+    if (!pending) {
+        tmr->ists = ~TMR_ISTS_OVFIF;
+    }
+    __set_PRIMASK(primask);
+}
+
 /*******************************************************************************
  * Function Declarations
  ******************************************************************************/
@@ -111,7 +185,7 @@
  * @brief Configure TMR14 for PWM generation and event generation
  * 
  * Configuration Summary:
- * - Timer clock source: TIMER_CLOCK_HZ (from crm.h - auto 120MHz/125MHz)
+ * - Timer clock source: TIMER_CLOCK_HZ (from crm.h - PLL solver)
  * - Timer frequency: PWM_TIMER_FREQ_HZ (10kHz)
  * - PWM frequency: PWM_FREQUENCY_HZ (configurable, default 1Hz)
  * - PWM duty cycle: PWM_DUTY_RATIO (configurable, default 10%)
@@ -128,14 +202,30 @@
  * - Channel 1: Enabled, active-low polarity
  * 
  * Clock Dependency:
- * - Automatically adjusts for 120MHz (HICK/most HEXT) or 125MHz (25MHz HEXT)
+ * - Automatically adjusts for 120MHz (HICK/most HEXT), 100MHz (25MHz HEXT
+ *   default) or whatever SYSTEM_CLOCK_HZ selects
  * - Timer prescaler calculated as: (TIMER_CLOCK_HZ / 10000) - 1
  * - For 120MHz: prescaler = 11999 (10kHz timer base)
- * - For 125MHz: prescaler = 12499 (10kHz timer base)
+ * - For 100MHz: prescaler = 9999 (10kHz timer base)
  * 
- * @note Timer clocks must be enabled before calling this function (done by crm_config)
+ * @note Acquires the TMR14 clock itself (crm_periph_acquire)
  * @note GPIO must be configured for TMR14_CH1 alternate function
  */
 void timer_config(void);
 
+/**
+ * @brief Microseconds until the next TMR14 overflow (scheduler tick)
+ */
+uint32_t timer_next_tick_us(void);
+
+/**
+ * @brief Account for time TMR14 was stopped (deep sleep)
+ *
+ * The counter is moved forward but never past the end of the period, so a
+ * tick that fell into the stopped time is raised on the next count.
+ * Fractions of a count are carried over.
+ * @param us Time the counter missed
+ */
+void timer_advance_us(uint32_t us);
+
 #endif /* TIMER_H */
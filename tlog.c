@@ -0,0 +1,123 @@
+/**
+ * Tokenized (Deferred-Format) Logging Implementation
+ *
+ * Both back ends are always compiled; --gc-sections drops the one the
+ * LOG_TOKENIZED setting does not reference.
+ */
+
+#include "tlog.h"
+#include "fmt.h"
+#include "usart.h"
+
+/**
+ * @brief Append a little-endian base-128 varint
+ * @return Pointer past the last byte written
+ */
+static uint8_t* put_varint(uint8_t* p, uint32_t value) {
+    while (value >= 0x80U) {
+        *p++ = (uint8_t)(value | 0x80U);
+        value >>= 7;
+    }
+    *p++ = (uint8_t)value;
+    return p;
+}
+
+/**
+ * @brief Queue a binary record: token plus varint-encoded arguments
+ */
+void tlog_emit(uint32_t token, const uint32_t* argv, uint32_t argc) {
+    uint8_t frame[TLOG_FRAME_MAX];
+    uint8_t* p = put_varint(frame + 2, token);
+
+    if (argc > TLOG_MAX_ARGS) {
+        argc = TLOG_MAX_ARGS;
+    }
+    while (argc--) {
+        p = put_varint(p, *argv++);
+    }
+
+    frame[0] = TLOG_SYNC;
+    frame[1] = (uint8_t)(p - frame - 2);
+
+    /* One write per frame, so a drop policy never splits a record */
+    usart_write(frame, (uint32_t)(p - frame));
+}
+
+/**
+ * @brief Format a record on the target and queue it as text
+ */
+void tlog_printf(const char* fmt, const uint32_t* argv, uint32_t argc) {
+    char line[TLOG_LINE_MAX];
+    uint32_t n = 0;
+
+    while (*fmt) {
+        const char* conv = fmt;
+        uint32_t width = 0, value;
+        char pad = ' ';
+
+        /* Room for the widest conversion; otherwise cut the record */
+        if (n > TLOG_LINE_MAX - FMT_I32_MAX) {
+            if (n > TLOG_LINE_MAX - 3U) {
+                n = TLOG_LINE_MAX - 3U;
+            }
+            line[n++] = '~';
+            line[n++] = '\r';
+            line[n++] = '\n';
+            break;
+        }
+
+        if (*fmt != '%') {
+            line[n++] = *fmt++;
+            continue;
+        }
+        fmt++;
+
+        if (*fmt == '%') {
+            line[n++] = *fmt++;
+            continue;
+        }
+        if (*fmt == '0') {
+            pad = '0';
+            fmt++;
+        }
+        while ((*fmt >= '0') && (*fmt <= '9')) {
+            width = width * 10U + (uint32_t)(*fmt++ - '0');
+        }
+        if (width > FMT_U32_MAX) {
+            width = FMT_U32_MAX;
+        }
+
+        value = argc ? *argv : 0U;
+        switch (*fmt) {
+        case 'u':
+            n += fmt_u32_pad(&line[n], value, width, pad);
+            break;
+        case 'd':
+            n += fmt_i32_pad(&line[n], (int32_t)value, width, pad);
+            break;
+        case 'x':
+        case 'X':
+            n += fmt_hex(&line[n], value, (width > FMT_HEX_MAX) ? FMT_HEX_MAX : width);
+            break;
+        case 'c':
+            line[n++] = (char)value;
+            break;
+        default:
+            /* Unknown conversion - print it verbatim, consume no argument */
+            line[n++] = *conv;
+            fmt = conv + 1;
+            continue;
+        }
+
+        if (argc) {
+            argv++;
+            argc--;
+        }
+        if (*fmt) {
+            fmt++;
+        }
+    }
+
+    /* One write per record, so a drop policy never splits it */
+    usart_write(line, n);
+}
@@ -0,0 +1,106 @@
+/**
+ * Tokenized (Deferred-Format) Logging
+ *
+ * Purpose: Send log records over USART1 either as plain text or as compact
+ *          binary frames that a host tool expands back into text
+ * Features: One macro, two build modes selected by LOG_TOKENIZED
+ * Performance: In tokenized mode a record is a string ID plus varint
+ *              arguments - typically 6-12 bytes instead of 40-80 characters,
+ *              with no formatting work on the target
+ * Usage: TLOG("TMR Events: %u, Wakes: %u\r\n", events, wakes);
+ *
+ * Configuration Options:
+ *   • LOG_TOKENIZED: 0 = format on target and send text (default)
+ *                    1 = send tokens, decode with tlog_decode.py
+ *                    (pass TOKENIZED=1 to make)
+ *   • TLOG_MAX_ARGS: Maximum arguments per record (default: 8)
+ *   • TLOG_LINE_MAX: Longest text record in bytes (default: 160); longer
+ *                    records are cut and end in "~\r\n"
+ *
+ * Format Strings:
+ *   Must be string literals. Supported conversions: %u %d %x %X %c %%.
+ *   %u and %d take an optional '0' flag and width (%5u, %08u, %6d); %x
+ *   always pads with zeros to its width (%08x). Every argument is passed
+ *   as a 32-bit word.
+ *
+ * Tokenized Mode:
+ *   Format strings are placed in the .log_fmt section, which sections.ld
+ *   marks as INFO: it is kept in the ELF but never loaded into flash. A
+ *   string's address in that section is its token, so IDs are small and
+ *   need no registry. Each record is sent as
+ *
+ *     TLOG_SYNC, payload length, varint(token), varint(arg0), ...
+ *
+ *   Varints are little-endian base-128. Bytes outside a frame are passed
+ *   through by the decoder, so usart_puts() output can be mixed in.
+ *
+ * Decoding:
+ *   python3 tlog_decode.py build/at32f421_project.elf capture.bin
+ */
+
+#ifndef TLOG_H
+#define TLOG_H
+
+#include <stdint.h>
+
+#ifndef LOG_TOKENIZED
+  #define LOG_TOKENIZED               0
+#endif
+
+#ifndef TLOG_MAX_ARGS
+  #define TLOG_MAX_ARGS               8U
+#endif
+
+#ifndef TLOG_LINE_MAX
+  #define TLOG_LINE_MAX               160U
+#endif
+
+/* First byte of every binary frame - never produced by ASCII text */
+#define TLOG_SYNC                   0xFFU
+
+/* Sync + length + token + arguments, 5 bytes per worst-case varint */
+#define TLOG_FRAME_MAX              (2U + 5U * (1U + TLOG_MAX_ARGS))
+
+/* Arguments are collected into a word array behind a dummy first element,
+ * so records without arguments still form a valid initializer. */
+#define TLOG_ARGV_(...)             ((const uint32_t[]){ 0U, ##__VA_ARGS__ } + 1)
+#define TLOG_ARGC_(...)             (sizeof((const uint32_t[]){ 0U, ##__VA_ARGS__ }) / sizeof(uint32_t) - 1U)
+
+#if LOG_TOKENIZED
+
+#define TLOG(fmt, ...)                                                          \
+    do {                                                                        \
+        static const char tlog_fmt_[]                                           \
+            __attribute__((section(".log_fmt"), used)) = fmt;                   \
+        tlog_emit((uint32_t)tlog_fmt_, TLOG_ARGV_(__VA_ARGS__),                 \
+                  TLOG_ARGC_(__VA_ARGS__));                                     \
+    } while (0)
+
+#else
+
+#define TLOG(fmt, ...)                                                          \
+    tlog_printf(fmt, TLOG_ARGV_(__VA_ARGS__), TLOG_ARGC_(__VA_ARGS__))
+
+#endif /* LOG_TOKENIZED */
+
+/**
+ * @brief Format a record on the target and queue it as text
+ *
+ * The line is built on the stack and queued with a single write, so the
+ * DROP and TRUNCATE overflow policies act on the record as a whole and
+ * never drop single fields out of it.
+ * @param fmt  Format string (string literal)
+ * @param argv Argument words
+ * @param argc Number of arguments
+ */
+void tlog_printf(const char* fmt, const uint32_t* argv, uint32_t argc);
+
+/**
+ * @brief Queue a binary record: token plus varint-encoded arguments
+ * @param token Address of the format string in the .log_fmt section
+ * @param argv  Argument words
+ * @param argc  Number of arguments (excess beyond TLOG_MAX_ARGS is dropped)
+ */
+void tlog_emit(uint32_t token, const uint32_t* argv, uint32_t argc);
+
+#endif /* TLOG_H */
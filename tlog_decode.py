@@ -0,0 +1,144 @@
+#!/usr/bin/env python3
+"""
+Host-side decoder for tokenized logging (tlog.h, LOG_TOKENIZED=1).
+
+Reads the format strings from the .log_fmt section of the firmware ELF and
+expands the binary frames in a captured USART1 stream back into text. Bytes
+outside frames are passed through unchanged.
+
+Usage:
+    python3 tlog_decode.py build/at32f421_project.elf capture.bin
+    python3 tlog_decode.py build/at32f421_project.elf /dev/ttyUSB0
+    cat capture.bin | python3 tlog_decode.py build/at32f421_project.elf
+
+For a live serial port, set the line parameters first, e.g.
+    stty -F /dev/ttyUSB0 115200 raw -echo
+"""
+
+import re
+import struct
+import sys
+
+TLOG_SYNC = 0xFF
+SECTION = ".log_fmt"
+
+
+def load_format_strings(elf_path):
+    """Return (base address, raw bytes) of the .log_fmt section."""
+    with open(elf_path, "rb") as f:
+        elf = f.read()
+
+    if elf[:4] != b"\x7fELF" or elf[4] != 1 or elf[5] != 1:
+        sys.exit("%s: not a 32-bit little-endian ELF" % elf_path)
+
+    e_shoff, = struct.unpack_from("<I", elf, 0x20)
+    e_shentsize, e_shnum, e_shstrndx = struct.unpack_from("<HHH", elf, 0x2E)
+
+    def section(index):
+        # name, type, flags, addr, offset, size
+        return struct.unpack_from("<IIIIII", elf, e_shoff + index * e_shentsize)
+
+    strtab = section(e_shstrndx)
+    for i in range(e_shnum):
+        name, _, _, addr, offset, size = section(i)
+        start = strtab[4] + name
+        if elf[start:elf.index(b"\0", start)].decode() == SECTION:
+            return addr, elf[offset:offset + size]
+
+    sys.exit("%s: no %s section (built without TOKENIZED=1?)" % (elf_path, SECTION))
+
+
+def lookup(base, table, token):
+    offset = token - base
+    if offset < 0 or offset >= len(table):
+        return None
+    return table[offset:table.index(b"\0", offset)].decode("ascii", "replace")
+
+
+def read_varint(payload, pos):
+    value = shift = 0
+    while True:
+        byte = payload[pos]
+        pos += 1
+        value |= (byte & 0x7F) << shift
+        shift += 7
+        if byte < 0x80:
+            return value, pos
+
+
+CONVERSION = re.compile(r"%(%|(0?)(\d*)([udxXc]))")
+
+
+def render(fmt, args):
+    """Apply the subset of printf conversions that tlog_printf() supports."""
+    args = list(args)
+
+    def convert(match):
+        if match.group(1) == "%":
+            return "%"
+        zero, width, conv = match.group(2), match.group(3), match.group(4)
+        value = args.pop(0) if args else 0
+        if conv == "d":
+            signed = value - (1 << 32) if value & 0x80000000 else value
+            return ("%0*d" if zero else "%*d") % (int(width or 0), signed)
+        if conv == "c":
+            return chr(value & 0xFF)
+        if conv in "xX":
+            text = "%X" % value
+            return text.rjust(int(width), "0") if width else text
+        text = str(value)
+        return text.rjust(int(width), "0" if zero else " ") if width else text
+
+    return CONVERSION.sub(convert, fmt)
+
+
+def decode(stream, base, table, out):
+    buf = b""
+    while True:
+        chunk = stream.read(1)
+        if not chunk:
+            break
+        buf += chunk
+
+        while buf:
+            if buf[0] != TLOG_SYNC:
+                # Plain text between frames
+                out.write(chr(buf[0]))
+                buf = buf[1:]
+                continue
+            if len(buf) < 2 or len(buf) < 2 + buf[1]:
+                break
+            payload, buf = buf[2:2 + buf[1]], buf[2 + buf[1]:]
+
+            try:
+                token, pos = read_varint(payload, 0)
+                args = []
+                while pos < len(payload):
+                    value, pos = read_varint(payload, pos)
+                    args.append(value)
+            except IndexError:
+                out.write("<truncated frame>\n")
+                continue
+
+            fmt = lookup(base, table, token)
+            if fmt is None:
+                out.write("<unknown token 0x%X %r>\n" % (token, args))
+            else:
+                out.write(render(fmt, args))
+        out.flush()
+
+
+def main():
+    if len(sys.argv) not in (2, 3):
+        sys.exit(__doc__)
+
+    base, table = load_format_strings(sys.argv[1])
+    if len(sys.argv) == 3:
+        with open(sys.argv[2], "rb", buffering=0) as stream:
+            decode(stream, base, table, sys.stdout)
+    else:
+        decode(sys.stdin.buffer, base, table, sys.stdout)
+
+
+if __name__ == "__main__":
+    main()
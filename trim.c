@@ -0,0 +1,147 @@
+/**
+ * HICK Oscillator Trimming Implementation
+ */
+
+#include "trim.h"
+#include "crm.h"
+
+/**
+ * @brief Stored record: the trim and its complement guard against blank
+ *        (all ones) and half-written pages
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t trim;
+    uint32_t check;
+} trim_record_t;
+
+#define TRIM_RECORD                 ((const trim_record_t*)TRIM_FLASH_ADDR)
+
+/**
+ * @brief Write a HICKTRIM value
+ */
+static void trim_set(uint32_t trim) {
+    CRM->ctrl = (CRM->ctrl & ~CRM_CTRL_HICKTRIM_Msk) | (trim << CRM_CTRL_HICKTRIM_Pos);
+}
+
+/**
+ * @brief Apply the stored trim, if any
+ */
+trim_status_t trim_init(void) {
+    const trim_record_t* rec = TRIM_RECORD;
+
+    if ((rec->magic != TRIM_MAGIC) || (rec->check != ~rec->trim) ||
+        (rec->trim > CRM_CTRL_HICKTRIM_MAX)) {
+        return TRIM_ERR_NO_RECORD;
+    }
+    trim_set(rec->trim);
+    return TRIM_OK;
+}
+
+/**
+ * @brief How far HICK runs fast, from one reference measurement
+ *
+ * A fast HICK makes a reference look slow: expected / measured - 1.
+ */
+int32_t trim_error_ppm(uint32_t expected, uint32_t measured) {
+    int64_t diff = (int64_t)expected - (int64_t)measured;
+
+    if (measured == 0U) {
+        return 0;
+    }
+    return (int32_t)((diff * 1000000) / (int64_t)measured);
+}
+
+/**
+ * @brief Correct HICK by a measured error
+ */
+trim_status_t trim_adjust_ppm(int32_t error_ppm) {
+    int32_t steps = (error_ppm >= 0)
+                  ? (error_ppm + (int32_t)(TRIM_STEP_PPM / 2U)) / (int32_t)TRIM_STEP_PPM
+                  : (error_ppm - (int32_t)(TRIM_STEP_PPM / 2U)) / (int32_t)TRIM_STEP_PPM;
+    int32_t trim = (int32_t)trim_get() - steps;
+    trim_status_t status = TRIM_OK;
+
+    if (trim < 0) {
+        trim = 0;
+        status = TRIM_ERR_RANGE;
+    } else if (trim > (int32_t)CRM_CTRL_HICKTRIM_MAX) {
+        trim = (int32_t)CRM_CTRL_HICKTRIM_MAX;
+        status = TRIM_ERR_RANGE;
+    }
+    trim_set((uint32_t)trim);
+    return status;
+}
+
+/**
+ * @brief Current HICKTRIM value
+ */
+uint32_t trim_get(void) {
+    return (CRM->ctrl & CRM_CTRL_HICKTRIM_Msk) >> CRM_CTRL_HICKTRIM_Pos;
+}
+
+/**
+ * @brief Wait for the flash controller, then collect and clear its status
+ */
+static trim_status_t trim_flash_wait(void) {
+    uint32_t timeout = TRIM_FLASH_TIMEOUT;
+    uint32_t sts;
+
+    while (FLASH->sts & FLASH_STS_OBF) {
+        if (--timeout == 0) {
+            return TRIM_ERR_FLASH;
+        }
+    }
+    sts = FLASH->sts;
+    FLASH->sts = FLASH_STS_PRGMERR | FLASH_STS_EPPERR | FLASH_STS_ODF;
+    return (sts & (FLASH_STS_PRGMERR | FLASH_STS_EPPERR)) ? TRIM_ERR_FLASH : TRIM_OK;
+}
+
+/**
+ * @brief Program one 32-bit word as two half-words
+ */
+static trim_status_t trim_flash_word(uint32_t addr, uint32_t value) {
+    trim_status_t status;
+
+    FLASH->ctrl |= FLASH_CTRL_FPRGM;
+    *(volatile uint16_t*)addr = (uint16_t)value;
+    status = trim_flash_wait();
+    if (status == TRIM_OK) {
+        *(volatile uint16_t*)(addr + 2U) = (uint16_t)(value >> 16);
+        status = trim_flash_wait();
+    }
+    FLASH->ctrl &= ~FLASH_CTRL_FPRGM;
+    return status;
+}
+
+/**
+ * @brief Store the current trim in TRIM_FLASH_ADDR
+ */
+trim_status_t trim_save(void) {
+    uint32_t trim = trim_get();
+    trim_status_t status;
+
+    FLASH->unlock = FLASH_UNLOCK_KEY1;
+    FLASH->unlock = FLASH_UNLOCK_KEY2;
+
+    /* Erase the page, then write the trim before the marker so that an
+     * interrupted save never leaves a valid-looking record */
+    FLASH->ctrl |= FLASH_CTRL_SECERS;
+    FLASH->addr = TRIM_FLASH_ADDR;
+    FLASH->ctrl |= FLASH_CTRL_ERSTR;
+    status = trim_flash_wait();
+    FLASH->ctrl &= ~FLASH_CTRL_SECERS;
+
+    if (status == TRIM_OK) {
+        status = trim_flash_word(TRIM_FLASH_ADDR + 4U, trim);
+    }
+    if (status == TRIM_OK) {
+        status = trim_flash_word(TRIM_FLASH_ADDR + 8U, ~trim);
+    }
+    if (status == TRIM_OK) {
+        status = trim_flash_word(TRIM_FLASH_ADDR, TRIM_MAGIC);
+    }
+
+    FLASH->ctrl |= FLASH_CTRL_OPLK;
+    return status;
+}
@@ -0,0 +1,130 @@
+/**
+ * HICK Oscillator Trimming
+ *
+ * Purpose: Pull the internal 8MHz HICK onto its nominal frequency, so that
+ *          crystal-less boards keep their baud rates within budget at
+ *          1-3 Mbaud
+ * Features: Converts a measurement against any reference into a HICKTRIM
+ *           correction, applies it at run time and keeps it in the last
+ *           flash page, from where trim_init() restores it at every boot
+ * Performance: trim_init() is one flash read and a register write; saving
+ *              erases and programs one page (milliseconds, core stalled)
+ * Usage: Restore the stored trim before the clocks are set up, measure a
+ *        reference, correct, and save once the result is good
+ *
+ *   trim_init();                      // before crm_config()
+ *   ...
+ *   int32_t ppm = trim_error_ppm(expected, measured);
+ *   trim_adjust_ppm(ppm);             // repeat measurement to refine
+ *   trim_save();
+ *
+ * References:
+ *   Any frequency or period measured with HICK-derived timers works:
+ *   expected is the value the reference has, measured what the untrimmed
+ *   clock made of it. The application uses a host-sent 'U' captured by
+ *   the USART autobaud timer (TMR1): expected = the host's baud rate,
+ *   measured = usart_get_baud() after autobaud. A 32.768kHz LEXT
+ *   counted against TMR6 fits the same formula.
+ *
+ * Configuration Options:
+ *   • TRIM_FLASH_ADDR: Page holding the record (default: last 1KB page of
+ *     the 64KB AT32F421x8; sections.ld keeps the image out of it)
+ *   • TRIM_STEP_PPM: HICK change per HICKTRIM step (default: 2500)
+ *
+ * Note: HICKTRIM moves HICK and everything derived from it - the PLL, and
+ *       with it every bus clock - so baud rates and timers follow the
+ *       correction without being reprogrammed.
+ */
+
+#ifndef TRIM_H
+#define TRIM_H
+
+#include "at32f421.h"
+
+#ifndef TRIM_FLASH_ADDR
+  #define TRIM_FLASH_ADDR             0x0800FC00U
+#endif
+
+/* HICK frequency change per HICKTRIM step, datasheet typical */
+#ifndef TRIM_STEP_PPM
+  #define TRIM_STEP_PPM               2500U
+#endif
+
+/* Record marker ("HICK") */
+#define TRIM_MAGIC                  0x4B434948U
+
+/* Flash operation limit in polling loops */
+#define TRIM_FLASH_TIMEOUT          1000000U
+
+/*******************************************************************************
+ * FLASH Register Bit Definitions
+ ******************************************************************************/
+
+/* FLASH STS */
+#define FLASH_STS_OBF_Pos           0       /* Operation busy */
+#define FLASH_STS_OBF               (0x1U << FLASH_STS_OBF_Pos)
+#define FLASH_STS_PRGMERR_Pos       2       /* Programming error */
+#define FLASH_STS_PRGMERR           (0x1U << FLASH_STS_PRGMERR_Pos)
+#define FLASH_STS_EPPERR_Pos        4       /* Erase/program protection error */
+#define FLASH_STS_EPPERR            (0x1U << FLASH_STS_EPPERR_Pos)
+#define FLASH_STS_ODF_Pos           5       /* Operation done */
+#define FLASH_STS_ODF               (0x1U << FLASH_STS_ODF_Pos)
+
+/* FLASH CTRL */
+#define FLASH_CTRL_FPRGM_Pos        0       /* Program */
+#define FLASH_CTRL_FPRGM            (0x1U << FLASH_CTRL_FPRGM_Pos)
+#define FLASH_CTRL_SECERS_Pos       1       /* Sector erase */
+#define FLASH_CTRL_SECERS           (0x1U << FLASH_CTRL_SECERS_Pos)
+#define FLASH_CTRL_ERSTR_Pos        6       /* Erase start */
+#define FLASH_CTRL_ERSTR            (0x1U << FLASH_CTRL_ERSTR_Pos)
+#define FLASH_CTRL_OPLK_Pos         7       /* Operation lock */
+#define FLASH_CTRL_OPLK             (0x1U << FLASH_CTRL_OPLK_Pos)
+
+/* FLASH UNLOCK keys */
+#define FLASH_UNLOCK_KEY1           0x45670123U
+#define FLASH_UNLOCK_KEY2           0xCDEF89ABU
+
+/**
+ * @brief Trimming result codes
+ */
+typedef enum {
+    TRIM_OK = 0,                    /*!< Done */
+    TRIM_ERR_NO_RECORD,             /*!< No valid record stored - factory trim in use */
+    TRIM_ERR_RANGE,                 /*!< Correction clipped at the HICKTRIM limit */
+    TRIM_ERR_FLASH                  /*!< Erase or program failed */
+} trim_status_t;
+
+/**
+ * @brief Apply the stored trim, if any
+ * @note Call first thing, before crm_config() locks the PLL to HICK
+ * @return TRIM_OK or TRIM_ERR_NO_RECORD
+ */
+trim_status_t trim_init(void);
+
+/**
+ * @brief How far HICK runs fast, from one reference measurement
+ * @param expected Reference value (frequency, baud rate, count)
+ * @param measured What HICK-derived timing made of it
+ * @return Error in ppm, positive if HICK is fast
+ */
+int32_t trim_error_ppm(uint32_t expected, uint32_t measured);
+
+/**
+ * @brief Correct HICK by a measured error
+ * @param error_ppm Result of trim_error_ppm()
+ * @return TRIM_OK, or TRIM_ERR_RANGE if the trim hit its limit
+ */
+trim_status_t trim_adjust_ppm(int32_t error_ppm);
+
+/**
+ * @brief Current HICKTRIM value (CRM_CTRL_HICKTRIM_DEFAULT = factory)
+ */
+uint32_t trim_get(void);
+
+/**
+ * @brief Store the current trim in TRIM_FLASH_ADDR
+ * @return TRIM_OK or TRIM_ERR_FLASH
+ */
+trim_status_t trim_save(void);
+
+#endif /* TRIM_H */
@@ -1,64 +1,994 @@
 /**
  * AT32F421 USART Configuration Implementation
+ *
+ * Transmit path: writers copy into a power-of-two ring and return. Head is
+ * only written by the producer (thread context), tail only by interrupt
+ * context, so the ring itself needs no locking.
+ *
+ * USART_TX_DMA == 1: the ring is drained by DMA1 channel 2 through a queue
+ *   of segments. A segment is either a contiguous run of ring bytes or a
+ *   caller-owned buffer handed over by usart_write_dma(). The transfer
+ *   complete interrupt releases ring space and chains the next segment,
+ *   so the CPU takes one exception per segment rather than per byte.
+ *
+ * USART_TX_DMA == 0: the TDBE interrupt moves one byte per data-register-
+ *   empty event and disables itself once the ring is empty.
+ *
+ * Receive path: DMA1 channel 3 fills a circular buffer with no CPU work per
+ * byte. The idle-line interrupt closes a frame and posts it to a small
+ * frame queue; the interrupt itself wakes the __WFE() loop, which then
+ * collects frames with usart_rx_frame(). Half/full transfer interrupts keep
+ * the free-running write index unambiguous and cut frames that outgrow
+ * half the buffer, so continuous streams are delivered too.
  */
 
 #include "usart.h"
+#include "event.h"
+#include "gpio.h"
+#include "prof.h"
+#include "ramfunc.h"
+#include "timer.h"
+
+/* Only thread-context control and receive paths log: the transmit path
+ * carries the log output itself */
+#define LOG_MODULE_NAME  "usart"
+#define LOG_MODULE_LEVEL LOG_LEVEL_USART
+#include "log.h"
+
+#define USART_TX_MASK               (USART_TX_BUFFER_SIZE - 1U)
+
+/* Transmit ring state - free-running indices, masked on access */
+static uint8_t tx_buffer[USART_TX_BUFFER_SIZE];
+static volatile uint32_t tx_head = 0;
+static volatile uint32_t tx_tail = 0;
+static uint32_t tx_dropped = 0;
+
+/* Core cycles spent spinning for queue space or drain (free-running) */
+static uint32_t tx_wait_cycles = 0;
+
+#if USART_TX_DMA
+
+#define USART_TX_SEG_MASK           (USART_TX_SEG_COUNT - 1U)
+
+/**
+ * @brief One DMA transfer worth of transmit data
+ */
+typedef struct {
+    const uint8_t* data;            /*!< First byte of the transfer */
+    uint16_t len;                   /*!< Transfer length in bytes */
+    uint16_t ring;                  /*!< Non-zero if data points into tx_buffer */
+} tx_seg_t;
+
+/* Segment queue - [seg_tail, seg_head) is pending, seg_tail is in flight
+ * while tx_active is set. seg_head is advanced by the producer only. */
+static tx_seg_t tx_seg[USART_TX_SEG_COUNT];
+static volatile uint32_t seg_head = 0;
+static volatile uint32_t seg_tail = 0;
+static volatile uint32_t tx_active = 0;
+
+/**
+ * @brief Program DMA1 channel 2 with one segment and start it
+ * @param seg Segment to transfer
+ */
+static void tx_dma_start(const tx_seg_t* seg) {
+    USART_TX_DMA_CHANNEL->ctrl  = 0;
+    USART_TX_DMA_CHANNEL->maddr = (uint32_t)seg->data;
+    USART_TX_DMA_CHANNEL->dtcnt = seg->len;
+    USART_TX_DMA_CHANNEL->ctrl  = DMA_CTRL_DTD |       /* Memory to peripheral */
+                                  DMA_CTRL_MINCM |     /* Increment memory address */
+                                  DMA_CTRL_FDTIEN |    /* Interrupt on completion */
+                                  DMA_CTRL_CHEN;
+    tx_active = 1;
+}
+
+/**
+ * @brief Number of free entries in the segment queue
+ */
+static uint32_t tx_seg_space(void) {
+    return USART_TX_SEG_COUNT - (seg_head - seg_tail);
+}
+
+/**
+ * @brief Append a segment, merging with the last queued one when possible
+ *
+ * A free entry must be available (checked by the caller). Runs with
+ * interrupts masked because the completion ISR walks the same queue.
+ * @param data First byte
+ * @param len  Length in bytes, at most USART_TX_DMA_MAX_LEN
+ * @param ring Non-zero if data lives in the transmit ring
+ */
+static void tx_seg_push(const uint8_t* data, uint32_t len, uint32_t ring) {
+    uint32_t primask = __get_PRIMASK();
+    uint32_t head;
+
+    __disable_irq();
+    head = seg_head;
+
+    /* Ring bytes that continue a not-yet-started ring segment extend it */
+    if (ring && ((head - seg_tail) > tx_active)) {
+        tx_seg_t* last = &tx_seg[(head - 1U) & USART_TX_SEG_MASK];
+
+        if (last->ring && (last->data + last->len == data) &&
+            ((uint32_t)last->len + len <= USART_TX_DMA_MAX_LEN)) {
+            last->len += (uint16_t)len;
+            __set_PRIMASK(primask);
+            return;
+        }
+    }
+
+    tx_seg[head & USART_TX_SEG_MASK].data = data;
+    tx_seg[head & USART_TX_SEG_MASK].len  = (uint16_t)len;
+    tx_seg[head & USART_TX_SEG_MASK].ring = (uint16_t)ring;
+    seg_head = head + 1U;
+
+    if (!tx_active) {
+        tx_dma_start(&tx_seg[seg_tail & USART_TX_SEG_MASK]);
+    }
+    __set_PRIMASK(primask);
+}
+
+/**
+ * @brief Wait for a free segment entry
+ */
+static void tx_seg_wait(void) {
+    if (tx_seg_space() == 0U) {
+        uint32_t start = DWT->CYCCNT;
+
+        while (tx_seg_space() == 0U) {
+            /* Wait for the completion ISR to retire a segment */
+        }
+        tx_wait_cycles += DWT->CYCCNT - start;
+    }
+}
+
+/**
+ * @brief Hand freshly copied ring bytes to the DMA queue
+ * @param start Free-running ring index of the first byte
+ * @param len   Number of bytes
+ */
+static void tx_kick(uint32_t start, uint32_t len) {
+    while (len) {
+        /* A segment must be contiguous, so split at the end of the ring */
+        uint32_t offset = start & USART_TX_MASK;
+        uint32_t chunk  = USART_TX_BUFFER_SIZE - offset;
+
+        if (chunk > len) {
+            chunk = len;
+        }
+        tx_seg_wait();
+        tx_seg_push(&tx_buffer[offset], chunk, 1U);
+        start += chunk;
+        len   -= chunk;
+    }
+}
+
+/**
+ * @brief Transmit DMA completion - retires the finished segment
+ */
+static void tx_dma_isr(void) {
+    if (DMA1->sts & DMA_STS_FDTF2) {
+        uint32_t tail = seg_tail;
+        const tx_seg_t* seg = &tx_seg[tail & USART_TX_SEG_MASK];
+
+        DMA1->clr = DMA_STS_GF2 | DMA_STS_FDTF2;
+
+        /* Ring segments complete in ring order, so space frees from tail */
+        if (seg->ring) {
+            tx_tail += seg->len;
+        }
+        seg_tail = ++tail;
+
+        if (tail != seg_head) {
+            tx_dma_start(&tx_seg[tail & USART_TX_SEG_MASK]);
+        } else {
+            USART_TX_DMA_CHANNEL->ctrl = 0;
+            tx_active = 0;
+            event_post(EVENT_TX_DONE, 0);
+        }
+    }
+}
+
+#else /* !USART_TX_DMA */
+
+/**
+ * @brief Start the TDBE interrupt for freshly copied ring bytes
+ */
+static void tx_kick(uint32_t start, uint32_t len) {
+    (void)start;
+    (void)len;
+    USART1->ctrl1 |= USART_CTRL1_TDBEIEN;
+}
+
+/**
+ * @brief Transmit data register empty - feeds the data register from the ring
+ */
+static void tx_tdbe_isr(void) {
+    if ((USART1->ctrl1 & USART_CTRL1_TDBEIEN) && (USART1->sts & USART_STS_TDBE)) {
+        uint32_t tail = tx_tail;
+
+        if (tail != tx_head) {
+            USART1->dt = tx_buffer[tail & USART_TX_MASK];
+            tx_tail = tail + 1U;
+        } else {
+            /* Ring drained - stop requesting data */
+            USART1->ctrl1 &= ~USART_CTRL1_TDBEIEN;
+            event_post(EVENT_TX_DONE, 0);
+        }
+    }
+}
+
+#endif /* USART_TX_DMA */
+
+/*******************************************************************************
+ * Baud rate
+ ******************************************************************************/
+
+static uint32_t usart_baud = USART_BAUD_RATE;
+
+/**
+ * @brief Rounded divisor and its error for a clock/baud pair
+ * @param clock_hz USART kernel clock
+ * @param baud     Requested baud rate
+ * @param ppm      Receives the deviation in ppm
+ * @return Divisor, or 0 if outside the BAUDR range
+ */
+static uint32_t usart_brr_calc(uint32_t clock_hz, uint32_t baud, uint32_t* ppm) {
+    uint32_t brr, actual, diff;
+
+    if ((baud == 0U) || (baud > clock_hz / USART_BRR_MIN)) {
+        return 0U;
+    }
+    brr = (clock_hz + baud / 2U) / baud;
+    if (brr > USART_BRR_MAX) {
+        return 0U;
+    }
+
+    /* Compare in the clock domain: brr * baud vs clock. Dividing the
+     * product by 1000 first keeps everything in 32 bits with ~0.01%
+     * resolution, since clock_hz is at least a few MHz. */
+    actual = brr * baud;
+    diff = (actual > clock_hz) ? (actual - clock_hz) : (clock_hz - actual);
+    *ppm = (diff * 1000U) / (actual / 1000U);
+    return brr;
+}
+
+/**
+ * @brief Write a new divisor with the USART briefly disabled
+ */
+static void usart_brr_apply(uint32_t brr) {
+    uint32_t ctrl1 = USART1->ctrl1;
+
+    USART1->ctrl1 = ctrl1 & ~USART_CTRL1_UEN;
+    USART1->baudr = brr;
+    USART1->ctrl1 = ctrl1;
+}
+
+/**
+ * @brief Change the baud rate at run time
+ */
+usart_status_t usart_set_baud(uint32_t baud) {
+    uint32_t ppm;
+    uint32_t brr = usart_brr_calc(crm_get_clocks()->apb2_hz, baud, &ppm);
+
+    if (brr == 0U) {
+        LOG_WARN("Baud %u out of range", baud);
+        return USART_ERR_BAUD_RANGE;
+    }
+    if (ppm > USART_BAUD_MAX_PPM) {
+        LOG_WARN("Baud %u rejected, error %uppm", baud, ppm);
+        return USART_ERR_BAUD_ERROR;
+    }
+
+    usart_flush();
+    usart_brr_apply(brr);
+    usart_baud = baud;
+    return USART_OK;
+}
+
+/**
+ * @brief Baud rate requested by the last successful usart_set_baud()
+ */
+uint32_t usart_get_baud(void) {
+    return usart_baud;
+}
+
+/**
+ * @brief Error of the programmed divisor against the requested rate
+ */
+uint32_t usart_baud_error_ppm(void) {
+    uint32_t ppm;
+
+    if (usart_brr_calc(crm_get_clocks()->apb2_hz, usart_baud, &ppm) == 0U) {
+        return 0xFFFFFFFFU;
+    }
+    return ppm;
+}
+
+/**
+ * @brief Reprogram the divisor after the APB2 clock changed
+ */
+void usart_clock_update(void) {
+    uint32_t ppm;
+    uint32_t brr = usart_brr_calc(crm_get_clocks()->apb2_hz, usart_baud, &ppm);
+
+    /* Out of range at the new clock: the nearest divisor is still the best
+     * the hardware can do, and the error shows in usart_baud_error_ppm(). */
+    if (brr == 0U) {
+        brr = (usart_baud > crm_get_clocks()->apb2_hz / USART_BRR_MIN) ?
+              USART_BRR_MIN : USART_BRR_MAX;
+    }
+    usart_brr_apply(brr);
+}
+
+/**
+ * @brief Clock change notifier: drain before the switch, re-divide after
+ */
+static void usart_clock_notify(crm_clock_event_t event) {
+    if (event == CRM_CLOCK_PRE_CHANGE) {
+        usart_flush();
+    } else {
+        usart_clock_update();
+    }
+}
+
+/*******************************************************************************
+ * Autobaud
+ ******************************************************************************/
+
+/* Sync character length in bit times: start + 8 data + stop */
+#define AUTOBAUD_CHAR_BITS          10U
+
+/* Input filter on TI3: 4 samples at the timer clock. Both edges see the
+ * same delay, so the measured width is unaffected. */
+#define AUTOBAUD_FILTER             (0x2U << TMR_CM2_C3DF_Pos)
+
+static volatile usart_autobaud_t autobaud_state = USART_AUTOBAUD_IDLE;
+
+/**
+ * @brief Give PA10 back to USART1 and switch TMR1 off
+ */
+static void autobaud_release(void) {
+    TMR1->ctrl1 = 0;
+    TMR1->iden  = 0;
+    TMR1->cctrl = 0;
+    GPIOA->muxh = (GPIOA->muxh & ~GPIO_PA10_MUXH_Msk) | GPIO_PA10_MUXH_AF1;
+    (void)crm_periph_release(CRM_PERIPH_TMR1);
+    NVIC_ClearPendingIRQ(TMR1_CH_IRQn);
+
+    USART1->ctrl1 |= USART_CTRL1_REN;
+}
+
+/**
+ * @brief Arm baud-rate detection on the next received character
+ */
+void usart_autobaud_start(void) {
+    USART1->ctrl1 &= ~USART_CTRL1_REN;
+
+    /* TMR1 is only clocked while a measurement is armed */
+    if (autobaud_state == USART_AUTOBAUD_IDLE) {
+        (void)crm_periph_acquire(CRM_PERIPH_TMR1);
+    }
+    TMR1->ctrl1 = 0;
+    TMR1->div   = 0;                        /* Count at the APB2 timer clock */
+    TMR1->pr    = 0xFFFFU;
+    TMR1->cm2   = TMR_CM2_C3C_DIRECT | AUTOBAUD_FILTER | TMR_CM2_C4C_INDIRECT;
+    TMR1->cctrl = TMR_CCTRL_C3EN | TMR_CCTRL_C3P |  /* CH3: falling edge */
+                  TMR_CCTRL_C4EN;                   /* CH4: rising edge */
+    TMR1->ists  = 0;
+    TMR1->iden  = TMR_IDEN_C4IEN;           /* Pend only - the NVIC line stays off */
+
+    autobaud_state = USART_AUTOBAUD_WAITING;
+    NVIC_ClearPendingIRQ(TMR1_CH_IRQn);
+    GPIOA->muxh = (GPIOA->muxh & ~GPIO_PA10_MUXH_Msk) | GPIO_PA10_MUXH_AF2;
+    TMR1->ctrl1 = TMR_CTRL1_CEN;
+}
+
+/**
+ * @brief Advance the autobaud measurement - call after every wakeup
+ */
+usart_autobaud_t usart_autobaud_poll(void) {
+    usart_autobaud_t state = autobaud_state;
+    uint32_t ists;
+
+    if (state == USART_AUTOBAUD_IDLE) {
+        return state;
+    }
+
+    /* Re-arm the wakeup before looking at the flags, so an edge that
+     * lands after this point still produces an event. */
+    NVIC_ClearPendingIRQ(TMR1_CH_IRQn);
+    ists = TMR1->ists;
+
+    if (state == USART_AUTOBAUD_WAITING) {
+        const crm_clocks_t* clocks = crm_get_clocks();
+        uint32_t ratio = clocks->tmr2_hz / clocks->apb2_hz;
+        uint32_t start, width, brr;
+
+        if (!(ists & TMR_ISTS_C4IF)) {
+            return state;
+        }
+        if (!(ists & TMR_ISTS_C3IF) || (ists & TMR_ISTS_C4RF)) {
+            /* Rising edge without a matching falling edge (armed mid-
+             * character): discard and wait for the next start bit. */
+            (void)TMR1->c4dt;
+            TMR1->ists = 0;
+            return state;
+        }
+
+        start = TMR1->c3dt;
+        width = (TMR1->c4dt - start) & 0xFFFFU;
+        TMR1->ists = 0;
+
+        /* The timer clock is PCLK2 or 2 x PCLK2; BAUDR counts PCLK2 */
+        brr = (width + ratio / 2U) / ratio;
+
+        if (brr < USART_BRR_MIN) {
+            autobaud_release();
+            autobaud_state = USART_AUTOBAUD_IDLE;
+            LOG_WARN("Autobaud: start bit too short (%u ticks)", width);
+            return USART_AUTOBAUD_FAILED;
+        }
+
+        /* PCLK2 ticks per bit are the divisor; program it straight away */
+        usart_brr_apply(brr);
+        usart_baud = (clocks->tmr2_hz + width / 2U) / width;
+
+        /* Keep the receiver off until the sync character's stop bit */
+        if (width * AUTOBAUD_CHAR_BITS > 0xFFFFU) {
+            autobaud_release();
+            autobaud_state = USART_AUTOBAUD_IDLE;
+            LOG_INFO("Autobaud: %u, Error: %uppm", usart_baud, usart_baud_error_ppm());
+            return USART_AUTOBAUD_DONE;
+        }
+        TMR1->c1dt = (start + width * AUTOBAUD_CHAR_BITS) & 0xFFFFU;
+        TMR1->iden = TMR_IDEN_C1IEN;
+        autobaud_state = USART_AUTOBAUD_SETTLING;
+        return USART_AUTOBAUD_SETTLING;
+    }
+
+    /* SETTLING */
+    if (!(ists & TMR_ISTS_C1IF)) {
+        return state;
+    }
+    autobaud_release();
+    autobaud_state = USART_AUTOBAUD_IDLE;
+    LOG_INFO("Autobaud: %u, Error: %uppm", usart_baud, usart_baud_error_ppm());
+    return USART_AUTOBAUD_DONE;
+}
+
+/*******************************************************************************
+ * Receive path
+ ******************************************************************************/
+
+#define USART_RX_MASK               (USART_RX_BUFFER_SIZE - 1U)
+#define USART_RX_FRAME_MASK         (USART_RX_FRAME_COUNT - 1U)
+
+/**
+ * @brief A received frame as a run of free-running ring indices
+ */
+typedef struct {
+    uint32_t start;                 /*!< Index of the first byte */
+    uint32_t len;                   /*!< Length in bytes */
+} rx_frame_t;
+
+/* DMA-filled receive ring. rx_write is the free-running DMA write index as
+ * last observed; it is updated only by rx_sync() with interrupts masked. */
+static uint8_t rx_buffer[USART_RX_BUFFER_SIZE];
+static volatile uint32_t rx_write = 0;
+static uint32_t rx_frame_start = 0;
+
+/* Frame queue - head advanced by interrupt context, tail by the consumer */
+static rx_frame_t rx_frames[USART_RX_FRAME_COUNT];
+static volatile uint32_t rx_frame_head = 0;
+static volatile uint32_t rx_frame_tail = 0;
+
+static usart_rx_stats_t rx_stats;
+
+/**
+ * @brief Bring rx_write up to the DMA's current position
+ *
+ * The DMA can advance by at most half the buffer between two calls (the
+ * half/full transfer interrupts guarantee a call), so the masked distance
+ * is unambiguous. Must run in interrupt context or with interrupts masked.
+ * @return Updated free-running write index
+ */
+static uint32_t rx_sync(void) {
+    uint32_t pos = (USART_RX_BUFFER_SIZE - USART_RX_DMA_CHANNEL->dtcnt) & USART_RX_MASK;
+    uint32_t write = rx_write;
+
+    write += (pos - write) & USART_RX_MASK;
+    rx_write = write;
+    return write;
+}
+
+/**
+ * @brief Close the frame in progress and post it to the frame queue
+ * @param end Free-running index one past the last byte of the frame
+ */
+RAMFUNC static void rx_frame_close(uint32_t end) {
+    uint32_t len = end - rx_frame_start;
+    uint32_t head = rx_frame_head;
+
+    if (len == 0U) {
+        return;
+    }
+
+    if ((head - rx_frame_tail) < USART_RX_FRAME_COUNT) {
+        rx_frames[head & USART_RX_FRAME_MASK].start = rx_frame_start;
+        rx_frames[head & USART_RX_FRAME_MASK].len   = len;
+        rx_frame_head = head + 1U;
+        rx_stats.frames++;
+        rx_stats.bytes += len;
+        event_post(EVENT_RX_FRAME, len);
+    } else {
+        rx_stats.frame_drops++;
+    }
+    rx_frame_start = end;
+}
+
+/**
+ * @brief Receive DMA half/full transfer - keeps long frames moving
+ */
+static void rx_dma_isr(void) {
+    if (DMA1->sts & (DMA_STS_HDTF3 | DMA_STS_FDTF3)) {
+        uint32_t write;
+
+        DMA1->clr = DMA_STS_GF3 | DMA_STS_HDTF3 | DMA_STS_FDTF3;
+        write = rx_sync();
+
+        /* Hand over frames that would otherwise be overwritten before idle */
+        if ((write - rx_frame_start) >= (USART_RX_BUFFER_SIZE / 2U)) {
+            rx_frame_close(write);
+        }
+    }
+}
+
+/**
+ * @brief USART receive events - idle line closes a frame, errors are counted
+ */
+static void rx_usart_isr(void) {
+    uint32_t sts = USART1->sts;
+
+    if (sts & (USART_STS_IDLEF | USART_STS_ROERR | USART_STS_FERR | USART_STS_NERR)) {
+        /* STS read followed by DT read clears these flags */
+        (void)USART1->dt;
+
+        if (sts & USART_STS_ROERR) {
+            rx_stats.hw_overruns++;
+        }
+        if (sts & (USART_STS_FERR | USART_STS_NERR)) {
+            rx_stats.line_errors++;
+        }
+        if (sts & USART_STS_IDLEF) {
+            rx_frame_close(rx_sync());
+        }
+    }
+}
+
+/**
+ * @brief Copy the oldest received frame out of the receive ring
+ * @param dst Destination buffer
+ * @param max Size of dst; longer frames are truncated
+ * @return Number of bytes copied, 0 if no frame is pending
+ */
+uint32_t usart_rx_frame(uint8_t* dst, uint32_t max) {
+#if LOG_ENABLED(LOG_LEVEL_WARN)
+    static uint32_t last_hw_overruns = 0;
+    static uint32_t last_frame_drops = 0;
+
+    /* Counted in interrupt context, reported here */
+    if ((rx_stats.hw_overruns != last_hw_overruns) || (rx_stats.frame_drops != last_frame_drops)) {
+        LOG_WARN("RX: %u overruns, %u frames dropped",
+                 rx_stats.hw_overruns - last_hw_overruns, rx_stats.frame_drops - last_frame_drops);
+        last_hw_overruns = rx_stats.hw_overruns;
+        last_frame_drops = rx_stats.frame_drops;
+    }
+#endif
+
+    while (rx_frame_tail != rx_frame_head) {
+        uint32_t tail  = rx_frame_tail;
+        uint32_t start = rx_frames[tail & USART_RX_FRAME_MASK].start;
+        uint32_t len   = rx_frames[tail & USART_RX_FRAME_MASK].len;
+        uint32_t n = (len < max) ? len : max;
+        uint32_t primask, write;
+
+        for (uint32_t i = 0; i < n; i++) {
+            dst[i] = rx_buffer[(start + i) & USART_RX_MASK];
+        }
+
+        /* If DMA lapped the frame while it waited or while we copied, the
+         * data is garbage - count it and move on to the next frame. */
+        primask = __get_PRIMASK();
+        __disable_irq();
+        write = rx_sync();
+        __set_PRIMASK(primask);
+        rx_frame_tail = tail + 1U;
+
+        if ((write - start) > USART_RX_BUFFER_SIZE) {
+            rx_stats.ring_overruns++;
+            LOG_WARN("RX: %u-byte frame overwritten in the ring", len);
+            continue;
+        }
+        return n;
+    }
+    return 0U;
+}
+
+/**
+ * @brief Receive statistics since reset
+ */
+const usart_rx_stats_t* usart_rx_stats(void) {
+    return &rx_stats;
+}
+
+/*******************************************************************************
+ * Interrupt handlers
+ ******************************************************************************/
+
+/**
+ * @brief DMA1 channel 2/3 interrupt handler - USART1 TX and RX channels
+ */
+RAMFUNC void DMA1_Channel3_2_IRQHandler(void) {
+#if USART_TX_DMA
+    tx_dma_isr();
+#endif
+    rx_dma_isr();
+}
+
+/**
+ * @brief USART1 interrupt handler
+ */
+RAMFUNC void USART1_IRQHandler(void) {
+    rx_usart_isr();
+#if !USART_TX_DMA
+    tx_tdbe_isr();
+#endif
+}
 
 /**
  * @brief Configure USART using direct register access with precise baud rate
  */
 void usart_config(void) {
+    (void)crm_periph_acquire(CRM_PERIPH_USART1);
+    (void)crm_periph_acquire(CRM_PERIPH_DMA1);
+
+    /* Receive DMA: circular, peripheral to memory, half/full interrupts */
+    USART_RX_DMA_CHANNEL->ctrl  = 0;
+    USART_RX_DMA_CHANNEL->paddr = (uint32_t)&USART1->dt;
+    USART_RX_DMA_CHANNEL->maddr = (uint32_t)rx_buffer;
+    USART_RX_DMA_CHANNEL->dtcnt = USART_RX_BUFFER_SIZE;
+    USART_RX_DMA_CHANNEL->ctrl  = DMA_CTRL_LM |         /* Circular */
+                                  DMA_CTRL_MINCM |      /* Increment memory address */
+                                  DMA_CTRL_HDTIEN |     /* Half transfer interrupt */
+                                  DMA_CTRL_FDTIEN |     /* Full transfer interrupt */
+                                  DMA_CTRL_CHEN;
+
+#if USART_TX_DMA
+    /* DMA writes straight into the data register on each TDBE request */
+    USART_TX_DMA_CHANNEL->ctrl  = 0;
+    USART_TX_DMA_CHANNEL->paddr = (uint32_t)&USART1->dt;
+    USART1->ctrl3 = USART_CTRL3_DMATEN | USART_CTRL3_DMAREN | USART_CTRL3_ERRIEN;
+#else
+    USART1->ctrl3 = USART_CTRL3_DMAREN | USART_CTRL3_ERRIEN;
+#endif
+
     /* Configure USART1 with precise baud rate from centralized clock */
     USART1->baudr = USART_BRR_VALUE;
-    USART1->ctrl1 = USART_CTRL1_TEN | USART_CTRL1_REN | USART_CTRL1_UEN;
+    USART1->ctrl1 = USART_CTRL1_TEN | USART_CTRL1_REN | USART_CTRL1_IDLEIEN |
+                    USART_CTRL1_UEN;
+
+    /* TDBEIEN is only set while the ring holds data, and the receive
+     * interrupts are always wanted, so both NVIC lines stay enabled. */
+    NVIC_ClearPendingIRQ(USART_DMA_IRQn);
+    NVIC_EnableIRQ(USART_DMA_IRQn);
+    NVIC_ClearPendingIRQ(USART1_IRQn);
+    NVIC_EnableIRQ(USART1_IRQn);
+
+#if USART_AUTOBAUD
+    usart_autobaud_start();
+#endif
+
+    (void)crm_notify_register(usart_clock_notify);
+}
+
+/**
+ * @brief Copy bytes into the ring and start transmission
+ * @param data Bytes to copy
+ * @param len  Number of bytes, must not exceed the free space
+ */
+static void tx_enqueue(const uint8_t* data, uint32_t len) {
+    uint32_t start = tx_head;
+    uint32_t head = start;
+
+    while (len--) {
+        tx_buffer[head & USART_TX_MASK] = *data++;
+        head++;
+    }
+
+    /* Publish the new bytes before interrupt context can look at them */
+    tx_head = head;
+    tx_kick(start, head - start);
 }
 
 /**
- * @brief Send a single character via USART
+ * @brief Free space in the ring as seen by a non-blocking writer
+ */
+static uint32_t tx_space(void) {
+#if USART_TX_DMA && (USART_TX_OVERFLOW_POLICY != USART_TX_OVERFLOW_BLOCK)
+    /* A write may need two segments when it wraps the ring */
+    if (tx_seg_space() < 2U) {
+        return 0U;
+    }
+#endif
+    return USART_TX_BUFFER_SIZE - (tx_head - tx_tail);
+}
+
+/**
+ * @brief Queue a single character for transmission via USART
  * @param ch Character to send
  */
 void usart_putchar(char ch) {
-    /* Wait for transmit data register to be empty */
-    while (!(USART1->sts & USART_STS_TDBE)) {
-        /* Wait */
+    usart_write(&ch, 1U);
+}
+
+/**
+ * @brief Queue a block of bytes for transmission via USART
+ * @param data Bytes to send
+ * @param len  Number of bytes
+ * @return Number of bytes queued
+ */
+uint32_t usart_write(const void* data, uint32_t len) {
+    const uint8_t* src = (const uint8_t*)data;
+    uint32_t space = tx_space();
+
+#if USART_TX_OVERFLOW_POLICY == USART_TX_OVERFLOW_BLOCK
+    uint32_t remaining = len;
+
+    while (remaining > space) {
+        uint32_t start;
+
+        /* Hand over what fits, then spin while interrupt context makes room */
+        tx_enqueue(src, space);
+        src += space;
+        remaining -= space;
+        start = DWT->CYCCNT;
+        do {
+            space = tx_space();
+        } while (space == 0U);
+        tx_wait_cycles += DWT->CYCCNT - start;
+    }
+    tx_enqueue(src, remaining);
+    return len;
+#elif USART_TX_OVERFLOW_POLICY == USART_TX_OVERFLOW_DROP
+    if (len > space) {
+        tx_dropped += len;
+        return 0U;
+    }
+    tx_enqueue(src, len);
+    return len;
+#else /* USART_TX_OVERFLOW_TRUNCATE */
+    if (len > space) {
+        tx_dropped += len - space;
+        len = space;
+    }
+    tx_enqueue(src, len);
+    return len;
+#endif
+}
+
+/**
+ * @brief Queue a buffer for DMA transmission without copying it
+ * @param buf Data to send
+ * @param len Number of bytes
+ * @return Number of bytes queued
+ */
+size_t usart_write_dma(const void* buf, size_t len) {
+#if USART_TX_DMA
+    const uint8_t* src = (const uint8_t*)buf;
+    size_t remaining = len;
+
+#if USART_TX_OVERFLOW_POLICY != USART_TX_OVERFLOW_BLOCK
+    /* Accept the write only if it fits the segment queue as a whole */
+    if ((len + USART_TX_DMA_MAX_LEN - 1U) / USART_TX_DMA_MAX_LEN > tx_seg_space()) {
+        tx_dropped += len;
+        return 0U;
+    }
+#endif
+
+    while (remaining) {
+        uint32_t chunk = (remaining > USART_TX_DMA_MAX_LEN) ? USART_TX_DMA_MAX_LEN
+                                                           : (uint32_t)remaining;
+        tx_seg_wait();
+        tx_seg_push(src, chunk, 0U);
+        src += chunk;
+        remaining -= chunk;
     }
-    
-    /* Send character */
-    USART1->dt = (uint8_t)ch;
+    return len;
+#else
+    return usart_write(buf, (uint32_t)len);
+#endif
+}
+
+/**
+ * @brief Check whether queued data is still being transmitted
+ */
+uint32_t usart_tx_busy(void) {
+#if USART_TX_DMA
+    return seg_head != seg_tail;
+#else
+    return tx_head != tx_tail;
+#endif
 }
 
 /**
- * @brief Send a null-terminated string via USART
+ * @brief Queue a null-terminated string for transmission via USART
  * @param str String to send
  */
 void usart_puts(const char* str) {
-    while (*str) {
-        usart_putchar(*str++);
+    PROF_SCOPE(usart_puts);
+    const char* end = str;
+
+    while (*end) {
+        end++;
+    }
+    usart_write(str, (uint32_t)(end - str));
+}
+
+/**
+ * @brief Claim contiguous space at the head of the transmit ring
+ * @param len Number of bytes needed
+ * @return Pointer to len writable bytes, or NULL
+ */
+char* usart_tx_claim(uint32_t len) {
+    uint32_t offset = tx_head & USART_TX_MASK;
+    uint32_t space = tx_space();
+
+    if ((space < len) || ((USART_TX_BUFFER_SIZE - offset) < len)) {
+        return NULL;
     }
+    return (char*)&tx_buffer[offset];
+}
+
+/**
+ * @brief Queue bytes previously written through usart_tx_claim()
+ * @param len Number of bytes written
+ */
+void usart_tx_commit(uint32_t len) {
+    uint32_t start = tx_head;
+
+    tx_head = start + len;
+    tx_kick(start, len);
 }
 
 /**
- * @brief Send an unsigned integer as decimal via USART
+ * @brief Queue an unsigned integer as decimal for transmission via USART
  * @param value Unsigned integer to send
  */
 void usart_put_uint(uint32_t value) {
-    char buffer[11];  /* Maximum digits for 32-bit uint + null terminator */
-    char* ptr = buffer + sizeof(buffer) - 1;
-    
-    /* Null terminate */
-    *ptr = '\0';
-    
-    /* Handle zero case */
-    if (value == 0) {
-        *(--ptr) = '0';
+    char* dst = usart_tx_claim(FMT_U32_MAX);
+
+    if (dst) {
+        /* Common case: digits land directly in the ring */
+        usart_tx_commit(fmt_u32(dst, value));
     } else {
-        /* Convert digits in reverse */
-        while (value > 0) {
-            *(--ptr) = '0' + (value % 10);
-            value /= 10;
+        char buffer[FMT_U32_MAX];
+        usart_write(buffer, fmt_u32(buffer, value));
+    }
+}
+
+/**
+ * @brief Queue a signed integer as decimal for transmission via USART
+ * @param value Signed integer to send
+ */
+void usart_put_int(int32_t value) {
+    char* dst = usart_tx_claim(FMT_I32_MAX);
+
+    if (dst) {
+        usart_tx_commit(fmt_i32(dst, value));
+    } else {
+        char buffer[FMT_I32_MAX];
+        usart_write(buffer, fmt_i32(buffer, value));
+    }
+}
+
+/**
+ * @brief Queue an unsigned integer as hexadecimal for transmission via USART
+ * @param value  Value to send
+ * @param digits Number of digits (1-8), or 0 for the minimal width
+ */
+void usart_put_hex(uint32_t value, uint32_t digits) {
+    char* dst = usart_tx_claim(FMT_HEX_MAX);
+
+    if (dst) {
+        usart_tx_commit(fmt_hex(dst, value, digits));
+    } else {
+        char buffer[FMT_HEX_MAX];
+        usart_write(buffer, fmt_hex(buffer, value, digits));
+    }
+}
+
+/**
+ * @brief Wait until every queued byte has left the shift register
+ */
+void usart_flush(void) {
+    uint32_t start = DWT->CYCCNT;
+
+    while (usart_tx_busy()) {
+        /* Wait for interrupt context to drain the queue */
+    }
+    while (!(USART1->sts & USART_STS_TDC)) {
+        /* Wait for the last frame to shift out */
+    }
+    tx_wait_cycles += DWT->CYCCNT - start;
+}
+
+/**
+ * @brief Number of bytes discarded by the overflow policy since reset
+ */
+uint32_t usart_tx_dropped(void) {
+    return tx_dropped;
+}
+
+/**
+ * @brief Core cycles spent busy-waiting on the transmitter since reset
+ */
+uint32_t usart_tx_wait_cycles(void) {
+    return tx_wait_cycles;
+}
+
+/**
+ * @brief Send bytes with polling
+ */
+static void tx_polled(const uint8_t* data, uint32_t len) {
+    while (len--) {
+        while (!(USART1->sts & USART_STS_TDBE)) {
+            /* Wait */
         }
+        USART1->dt = *data++;
+    }
+}
+
+/**
+ * @brief Send a string with polling, bypassing the interrupt path
+ * @param str String to send
+ */
+void usart_panic_puts(const char* str) {
+    const char* end = str;
+
+#if USART_TX_DMA
+    NVIC_DisableIRQ(USART_DMA_IRQn);
+
+    /* Let the segment in flight finish, then push the rest by hand */
+    if (tx_active) {
+        while (!(DMA1->sts & DMA_STS_FDTF2)) {
+            /* Wait */
+        }
+        DMA1->clr = DMA_STS_GF2 | DMA_STS_FDTF2;
+        USART_TX_DMA_CHANNEL->ctrl = 0;
+        seg_tail++;
+        tx_active = 0;
+    }
+    while (seg_tail != seg_head) {
+        const tx_seg_t* seg = &tx_seg[seg_tail & USART_TX_SEG_MASK];
+        tx_polled(seg->data, seg->len);
+        seg_tail++;
+    }
+    tx_tail = tx_head;
+#else
+    uint32_t tail = tx_tail;
+
+    USART1->ctrl1 &= ~USART_CTRL1_TDBEIEN;
+
+    /* Flush pending ring contents first, then the message itself */
+    while (tail != tx_head) {
+        tx_polled(&tx_buffer[tail & USART_TX_MASK], 1U);
+        tail++;
+    }
+    tx_tail = tail;
+#endif
+
+    while (*end) {
+        end++;
     }
-    
-    /* Send the string */
-    usart_puts(ptr);
+    tx_polled((const uint8_t*)str, (uint32_t)(end - str));
 }
@@ -3,20 +3,44 @@
  *
  * Purpose: Configure USART for serial communication with printf support
  * Features: Precise baud rate calculation with automatic BRR calculation
- * Performance: Optimized for centralized system clock operation
+ * Performance: DMA-driven transmit queue, writers never busy-wait on the data
+ *              register and constant strings are sent without copying
  * Usage: Define USART_BAUD_RATE or use default (115200)
  *
  * Configuration Options:
- * • USART_BAUD_RATE: Baud rate in bps (default: 115200)
+ * • USART_BAUD_RATE: Baud rate in bps after usart_config() (default: 115200)
+ * • USART_BAUD_MAX_PPM: Largest baud error usart_set_baud() accepts (default: 25000)
+ * • USART_TX_BUFFER_SIZE: Transmit ring size in bytes, power of two (default: 256)
+ * • USART_TX_OVERFLOW_POLICY: What a write does when the ring is full
+ *     - USART_TX_OVERFLOW_BLOCK:    wait until the ISR frees space (default)
+ *     - USART_TX_OVERFLOW_DROP:     discard the whole write
+ *     - USART_TX_OVERFLOW_TRUNCATE: enqueue what fits, discard the rest
+ * • USART_TX_DMA: 1 = DMA1 channel 2 drains the queue (default),
+ *                 0 = TDBE interrupt moves one byte per event
+ * • USART_TX_SEG_COUNT: Depth of the DMA segment queue, power of two (default: 16)
+ * • USART_RX_BUFFER_SIZE: Circular DMA receive buffer, power of two (default: 256)
+ * • USART_RX_FRAME_COUNT: Depth of the received-frame queue, power of two (default: 8)
+ * • USART_AUTOBAUD: 1 = usart_config() arms baud detection on the first
+ *                   received character (default: 0)
  *
- * Note: USART clocks must be enabled before calling usart_config()
+ * Note: usart_config() acquires the USART1 and DMA1 clocks itself
  *       Clock frequency automatically sourced from crm.h
+ *       The ring has a single producer: call the output functions from thread
+ *       context only (fault handlers use usart_panic_puts())
  *
  * Key Features:
  * ✓ Direct register access (no bitfield structures)
  * ✓ Precise baud rate calculation with rounding
- * ✓ Automatic clock frequency adjustment (120MHz/125MHz)
+ * ✓ Automatic clock frequency adjustment (120MHz, 100MHz with a 25MHz HEXT)
  * ✓ Baud rate error calculation and validation
+ * ✓ Runtime usart_set_baud() up to PCLK2/16 (7.5 Mbaud at 120MHz)
+ * ✓ usart_clock_update() keeps the baud rate across clock changes
+ * ✓ Autobaud from one start bit via TMR1 input capture, no busy-waiting
+ * ✓ Power-of-two ring, usart_puts() returns at once
+ * ✓ Zero-copy usart_write_dma() for constant data (one interrupt per segment)
+ * ✓ Numbers are formatted by fmt.h directly into the ring, without UDIV
+ * ✓ Circular DMA reception with idle-line framing, no CPU work per byte
+ * ✓ Receive overrun and line error statistics
  * ✓ No standard library dependencies
  *
  * Example Usage:
@@ -24,19 +48,100 @@
  *   crm_config();                 // Enable clocks first
  *   usart_config();               // Initialize USART
  *   usart_puts("Hello World!\n"); // Print to USART
+ *   usart_set_baud(4000000);      // Switch to 4 Mbaud (exact at 120MHz)
  */
 
 #ifndef USART_H
 #define USART_H
 
+#include <stddef.h>
 #include "at32f421.h"
 #include "crm.h"
+#include "fmt.h"
 
 /* Configuration macros */
 #ifndef USART_BAUD_RATE
   #define USART_BAUD_RATE             115200U
 #endif
 
+#ifndef USART_BAUD_MAX_PPM
+  #define USART_BAUD_MAX_PPM          25000U
+#endif
+
+#ifndef USART_AUTOBAUD
+  #define USART_AUTOBAUD              0
+#endif
+
+#ifndef USART_TX_BUFFER_SIZE
+  #define USART_TX_BUFFER_SIZE        256U
+#endif
+
+#if (USART_TX_BUFFER_SIZE < 2U) || ((USART_TX_BUFFER_SIZE & (USART_TX_BUFFER_SIZE - 1U)) != 0U)
+  #error "USART_TX_BUFFER_SIZE must be a power of two"
+#endif
+
+/* Transmit ring overflow policies */
+#define USART_TX_OVERFLOW_BLOCK     0U
+#define USART_TX_OVERFLOW_DROP      1U
+#define USART_TX_OVERFLOW_TRUNCATE  2U
+
+#ifndef USART_TX_OVERFLOW_POLICY
+  #define USART_TX_OVERFLOW_POLICY    USART_TX_OVERFLOW_BLOCK
+#endif
+
+#if USART_TX_OVERFLOW_POLICY > USART_TX_OVERFLOW_TRUNCATE
+  #error "Unsupported USART_TX_OVERFLOW_POLICY"
+#endif
+
+#ifndef USART_TX_DMA
+  #define USART_TX_DMA                1
+#endif
+
+#ifndef USART_TX_SEG_COUNT
+  #define USART_TX_SEG_COUNT          16U
+#endif
+
+#if (USART_TX_SEG_COUNT < 2U) || ((USART_TX_SEG_COUNT & (USART_TX_SEG_COUNT - 1U)) != 0U)
+  #error "USART_TX_SEG_COUNT must be a power of two"
+#endif
+
+#ifndef USART_RX_BUFFER_SIZE
+  #define USART_RX_BUFFER_SIZE        256U
+#endif
+
+#if (USART_RX_BUFFER_SIZE < 4U) || ((USART_RX_BUFFER_SIZE & (USART_RX_BUFFER_SIZE - 1U)) != 0U)
+  #error "USART_RX_BUFFER_SIZE must be a power of two"
+#endif
+
+#ifndef USART_RX_FRAME_COUNT
+  #define USART_RX_FRAME_COUNT        8U
+#endif
+
+#if (USART_RX_FRAME_COUNT < 2U) || ((USART_RX_FRAME_COUNT & (USART_RX_FRAME_COUNT - 1U)) != 0U)
+  #error "USART_RX_FRAME_COUNT must be a power of two"
+#endif
+
+/* The IRQn values for USART1 and the DMA channel pair serving USART1.
+ * These values should be verified in the device's official startup file. */
+#ifndef USART1_IRQn
+  #define USART1_IRQn                 27
+#endif
+
+#ifndef DMA1_Channel3_2_IRQn
+  #define DMA1_Channel3_2_IRQn        10
+#endif
+
+/* USART1_TX/RX requests are hard-wired to DMA1 channels 2/3 (flexible
+ * mapping off); both channels share one interrupt line. */
+#define USART_TX_DMA_CHANNEL        DMA1_CHANNEL2
+#define USART_RX_DMA_CHANNEL        DMA1_CHANNEL3
+#define USART_DMA_IRQn              DMA1_Channel3_2_IRQn
+#define USART_TX_DMA_MAX_LEN        0xFFFFU
+
+#ifndef TMR1_CH_IRQn
+  #define TMR1_CH_IRQn                14
+#endif
+
 /* USART BRR calculation using centralized clock from crm.h */
 #define USART_BRR_VALUE             ((USART1_CLOCK_HZ + (USART_BAUD_RATE / 2)) / USART_BAUD_RATE)
 
@@ -48,11 +153,15 @@
                                       (USART_ACTUAL_BAUD - USART_BAUD_RATE) : \
                                       (USART_BAUD_RATE - USART_ACTUAL_BAUD)) * 1000000U / USART_BAUD_RATE)
 
-/* Validate baud rate error is acceptable (< 2.5%) */
-#if USART_ERROR_PPM > 25000U
+/* Validate baud rate error is acceptable (< 2.5% by default) */
+#if USART_ERROR_PPM > USART_BAUD_MAX_PPM
   #warning "USART baud rate error exceeds 2.5%, consider different baud rate"
 #endif
 
+/* BAUDR limits: 16x oversampling needs a divisor of at least 16 */
+#define USART_BRR_MIN               16U
+#define USART_BRR_MAX               0xFFFFU
+
 /* USART CTRL1 register bit definitions */
 #define USART_CTRL1_UEN_Pos         13
 #define USART_CTRL1_UEN             (0x1U << USART_CTRL1_UEN_Pos)
@@ -63,7 +172,35 @@
 #define USART_CTRL1_REN_Pos         2
 #define USART_CTRL1_REN             (0x1U << USART_CTRL1_REN_Pos)
 
+#define USART_CTRL1_IDLEIEN_Pos     4
+#define USART_CTRL1_IDLEIEN         (0x1U << USART_CTRL1_IDLEIEN_Pos)
+
+#define USART_CTRL1_TDBEIEN_Pos     7
+#define USART_CTRL1_TDBEIEN         (0x1U << USART_CTRL1_TDBEIEN_Pos)
+
+/* USART CTRL3 register bit definitions */
+#define USART_CTRL3_ERRIEN_Pos      0
+#define USART_CTRL3_ERRIEN          (0x1U << USART_CTRL3_ERRIEN_Pos)
+
+#define USART_CTRL3_DMAREN_Pos      6
+#define USART_CTRL3_DMAREN          (0x1U << USART_CTRL3_DMAREN_Pos)
+
+#define USART_CTRL3_DMATEN_Pos      7
+#define USART_CTRL3_DMATEN          (0x1U << USART_CTRL3_DMATEN_Pos)
+
 /* USART STS register bit definitions */
+#define USART_STS_FERR_Pos          1
+#define USART_STS_FERR              (0x1U << USART_STS_FERR_Pos)
+
+#define USART_STS_NERR_Pos          2
+#define USART_STS_NERR              (0x1U << USART_STS_NERR_Pos)
+
+#define USART_STS_ROERR_Pos         3
+#define USART_STS_ROERR             (0x1U << USART_STS_ROERR_Pos)
+
+#define USART_STS_IDLEF_Pos         4
+#define USART_STS_IDLEF             (0x1U << USART_STS_IDLEF_Pos)
+
 #define USART_STS_TDC_Pos           6
 #define USART_STS_TDC               (0x1U << USART_STS_TDC_Pos)
 
@@ -73,27 +210,249 @@
 #define USART_STS_RDBF_Pos          5
 #define USART_STS_RDBF              (0x1U << USART_STS_RDBF_Pos)
 
+/* DMA channel CTRL register bit definitions */
+#define DMA_CTRL_CHEN_Pos           0
+#define DMA_CTRL_CHEN               (0x1U << DMA_CTRL_CHEN_Pos)
+#define DMA_CTRL_FDTIEN_Pos         1
+#define DMA_CTRL_FDTIEN             (0x1U << DMA_CTRL_FDTIEN_Pos)
+#define DMA_CTRL_HDTIEN_Pos         2
+#define DMA_CTRL_HDTIEN             (0x1U << DMA_CTRL_HDTIEN_Pos)
+#define DMA_CTRL_DTD_Pos            4       /* 1 = memory to peripheral */
+#define DMA_CTRL_DTD                (0x1U << DMA_CTRL_DTD_Pos)
+#define DMA_CTRL_MINCM_Pos          7
+#define DMA_CTRL_MINCM              (0x1U << DMA_CTRL_MINCM_Pos)
+#define DMA_CTRL_LM_Pos             5       /* Loop (circular) mode */
+#define DMA_CTRL_LM                 (0x1U << DMA_CTRL_LM_Pos)
+
+/* DMA STS/CLR flags for channels 2 and 3 (four bits per channel) */
+#define DMA_STS_GF2_Pos             4
+#define DMA_STS_GF2                 (0x1U << DMA_STS_GF2_Pos)
+#define DMA_STS_FDTF2_Pos           5
+#define DMA_STS_FDTF2               (0x1U << DMA_STS_FDTF2_Pos)
+#define DMA_STS_GF3_Pos             8
+#define DMA_STS_GF3                 (0x1U << DMA_STS_GF3_Pos)
+#define DMA_STS_FDTF3_Pos           9
+#define DMA_STS_FDTF3               (0x1U << DMA_STS_FDTF3_Pos)
+#define DMA_STS_HDTF3_Pos           10
+#define DMA_STS_HDTF3               (0x1U << DMA_STS_HDTF3_Pos)
+
+/**
+ * @brief USART operation result codes
+ */
+typedef enum {
+    USART_OK = 0,                   /*!< Operation completed successfully */
+    USART_ERR_BAUD_RANGE,           /*!< Divisor outside USART_BRR_MIN..USART_BRR_MAX */
+    USART_ERR_BAUD_ERROR            /*!< Achievable rate off by more than USART_BAUD_MAX_PPM */
+} usart_status_t;
+
+/**
+ * @brief Autobaud state reported by usart_autobaud_poll()
+ */
+typedef enum {
+    USART_AUTOBAUD_IDLE = 0,        /*!< Not armed */
+    USART_AUTOBAUD_WAITING,         /*!< Waiting for the sync character */
+    USART_AUTOBAUD_SETTLING,        /*!< Rate set, letting the sync character pass */
+    USART_AUTOBAUD_DONE,            /*!< New rate in effect (reported once) */
+    USART_AUTOBAUD_FAILED           /*!< Start bit outside the BAUDR range (reported once) */
+} usart_autobaud_t;
+
+/**
+ * @brief Receive statistics
+ */
+typedef struct {
+    uint32_t frames;                /*!< Frames posted to the frame queue */
+    uint32_t bytes;                 /*!< Bytes in posted frames */
+    uint32_t frame_drops;           /*!< Frames lost because the frame queue was full */
+    uint32_t ring_overruns;         /*!< Frames discarded after DMA overwrote them */
+    uint32_t hw_overruns;           /*!< USART overrun errors (byte lost in hardware) */
+    uint32_t line_errors;           /*!< Framing and noise errors */
+} usart_rx_stats_t;
+
 /**
  * @brief Configure USART using direct register access with precise baud rate
  */
 void usart_config(void);
 
 /**
- * @brief Send a single character via USART
+ * @brief Queue a single character for transmission via USART
  * @param ch Character to send
  */
 void usart_putchar(char ch);
 
 /**
- * @brief Send a null-terminated string via USART
+ * @brief Queue a block of bytes for transmission via USART
+ * @param data Bytes to send
+ * @param len  Number of bytes
+ * @return Number of bytes queued (less than len only for DROP/TRUNCATE policies)
+ */
+uint32_t usart_write(const void* data, uint32_t len);
+
+/**
+ * @brief Queue a buffer for DMA transmission without copying it
+ *
+ * The buffer is read directly by DMA, so it must stay unchanged until the
+ * transfer completes - string literals and other flash constants are the
+ * intended use. Ordering relative to usart_puts() and friends is preserved.
+ * Completion raises the DMA interrupt, which also wakes a pending __WFE().
+ * With USART_TX_DMA == 0 the data is copied into the ring instead.
+ * @param buf Data to send
+ * @param len Number of bytes
+ * @return Number of bytes queued (0 if dropped by the overflow policy)
+ */
+size_t usart_write_dma(const void* buf, size_t len);
+
+/**
+ * @brief Queue a string literal for zero-copy transmission
+ */
+#define usart_puts_const(s)         usart_write_dma((s), sizeof(s) - 1U)
+
+/**
+ * @brief Check whether queued data is still being transmitted
+ * @return Non-zero while the transmit queue is not empty
+ */
+uint32_t usart_tx_busy(void);
+
+/**
+ * @brief Queue a null-terminated string for transmission via USART
  * @param str String to send
  */
 void usart_puts(const char* str);
 
 /**
- * @brief Send an unsigned integer as decimal via USART
+ * @brief Queue an unsigned integer as decimal for transmission via USART
  * @param value Unsigned integer to send
  */
 void usart_put_uint(uint32_t value);
 
+/**
+ * @brief Queue a signed integer as decimal for transmission via USART
+ * @param value Signed integer to send
+ */
+void usart_put_int(int32_t value);
+
+/**
+ * @brief Queue an unsigned integer as hexadecimal for transmission via USART
+ * @param value  Value to send
+ * @param digits Number of digits (1-8), or 0 for the minimal width
+ */
+void usart_put_hex(uint32_t value, uint32_t digits);
+
+/**
+ * @brief Claim contiguous space at the head of the transmit ring
+ *
+ * Lets formatters write their output in place instead of copying it in.
+ * The claim is only valid until the next output call.
+ * @param len Number of bytes needed
+ * @return Pointer to len writable bytes, or NULL if not available right now
+ */
+char* usart_tx_claim(uint32_t len);
+
+/**
+ * @brief Queue bytes previously written through usart_tx_claim()
+ * @param len Number of bytes actually written (at most the claimed length)
+ */
+void usart_tx_commit(uint32_t len);
+
+/**
+ * @brief Wait until every queued byte has left the shift register
+ */
+void usart_flush(void);
+
+/**
+ * @brief Number of bytes discarded by the overflow policy since reset
+ */
+uint32_t usart_tx_dropped(void);
+
+/**
+ * @brief Core cycles spent busy-waiting on the transmitter since reset
+ *
+ * Counts the spins for ring or segment space and usart_flush(). The value
+ * is free-running and wraps - subtract two readings to get an interval.
+ * @note Needs the DWT cycle counter running (prof_init())
+ */
+uint32_t usart_tx_wait_cycles(void);
+
+/**
+ * @brief Change the baud rate at run time
+ *
+ * The divisor is computed from the live APB2 clock (crm_get_clocks()).
+ * Queued output is flushed first so no byte straddles the change; an
+ * invalid request leaves the current setting untouched.
+ * @param baud Baud rate in bps
+ * @return USART_OK, or why the rate cannot be generated
+ */
+usart_status_t usart_set_baud(uint32_t baud);
+
+/**
+ * @brief Baud rate requested by the last successful usart_set_baud()
+ */
+uint32_t usart_get_baud(void);
+
+/**
+ * @brief Error of the programmed divisor against the requested rate
+ * @return Deviation in ppm, 0xFFFFFFFF if the current clock cannot reach it
+ */
+uint32_t usart_baud_error_ppm(void);
+
+/**
+ * @brief Reprogram the divisor after the APB2 clock changed
+ *
+ * Call with the transmitter idle, after crm_get_clocks() reports the new
+ * frequency. Keeps the current baud rate when the new clock can produce it.
+ * usart_config() registers this with crm_notify_register(), so
+ * crm_set_sysclk() needs no help from the application.
+ */
+void usart_clock_update(void);
+
+/**
+ * @brief Arm baud-rate detection on the next received character
+ *
+ * TMR1 CH3 takes over PA10 and captures the falling edge of the next start
+ * bit, CH4 (mapped to the same input) its rising edge. TMR1 counts at the
+ * APB2 timer clock, twice PCLK2 when APB2 is divided, so the difference
+ * in ticks is scaled down to PCLK2 ticks to give the BAUDR value. The
+ * sender must use a sync character whose bit 0 is 1, so the start bit
+ * stands alone: 'U' (0x55) or '\r' both work.
+ *
+ * No interrupt handler runs: the capture sets the TMR1_CH pending bit,
+ * which wakes __WFE() through SEVONPEND, and usart_autobaud_poll() finishes
+ * the job. The receiver is off while armed; arm with the line idle.
+ */
+void usart_autobaud_start(void);
+
+/**
+ * @brief Advance the autobaud measurement - call after every wakeup
+ *
+ * The new rate is programmed as soon as the start bit has been measured;
+ * the receiver comes back once the rest of the sync character has passed,
+ * i.e. within one character time of the first edge.
+ * @return Current state; DONE and FAILED are returned once, IDLE follows
+ */
+usart_autobaud_t usart_autobaud_poll(void);
+
+/**
+ * @brief Copy the oldest received frame out of the receive ring
+ *
+ * A frame ends at an idle line, or after half the receive buffer for
+ * continuous streams. Call after each wakeup until it returns 0.
+ * @param dst Destination buffer
+ * @param max Size of dst; longer frames are truncated
+ * @return Number of bytes copied, 0 if no frame is pending
+ */
+uint32_t usart_rx_frame(uint8_t* dst, uint32_t max);
+
+/**
+ * @brief Receive statistics since reset
+ */
+const usart_rx_stats_t* usart_rx_stats(void);
+
+/**
+ * @brief Send a string with polling, bypassing the interrupt path
+ *
+ * Drains whatever is still queued first so output stays in order. Intended
+ * for fault handlers, where the USART interrupt can no longer preempt.
+ * @param str String to send
+ */
+void usart_panic_puts(const char* str);
+
 #endif /* USART_H */